@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "analyze.h"
+
+//Chunks are sized so each worker gets about this many, for load balancing, within the bounds below
+const size_t CHUNKS_PER_THREAD = 16;
+const size_t MIN_CHUNK_BYTES = 4 * 1024;
+const size_t MAX_CHUNK_BYTES = 1024 * 1024;
+//Workers may run at most this many chunks per thread ahead of the writer, bounding buffered output
+const size_t CHUNK_WINDOW_PER_THREAD = 8;
+
+/**
+ * A run of whole lines of the input and the result lines for them
+*/
+struct AnalysisChunk {
+    const char* begin;
+    const char* end;
+    std::string output;
+    uint64_t nodes = 0;
+    int positions = 0;
+    bool done = false;
+};
+
+struct AnalysisState {
+    const SearchLimits* limits;
+    size_t hashMegabytes;
+    std::vector<AnalysisChunk> chunks;
+    std::atomic<size_t> nextChunk{0};
+
+    //Guards done flags and written
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t written = 0;
+    size_t window = 0;
+};
+
+/**
+ * Splits [begin, end) into chunks of about chunkBytes, each ending just
+ * after a newline (or at the end of the input)
+*/
+static std::vector<AnalysisChunk> splitLines(const char* begin, const char* end, size_t chunkBytes){
+    std::vector<AnalysisChunk> chunks;
+    const char* start = begin;
+    while(start < end){
+        const char* stop = start + std::min(chunkBytes, size_t(end - start));
+        if(stop < end){
+            const char* newline = static_cast<const char*>(std::memchr(stop, '\n', end - stop));
+            stop = newline ? newline + 1 : end;
+        }
+        AnalysisChunk chunk;
+        chunk.begin = start;
+        chunk.end = stop;
+        chunks.push_back(chunk);
+        start = stop;
+    }
+    return chunks;
+}
+
+static void analyzeChunk(AnalysisChunk& chunk, const SearchLimits& limits, TranspositionTable& table){
+    const char* lineStart = chunk.begin;
+    while(lineStart < chunk.end){
+        const char* lineEnd = static_cast<const char*>(std::memchr(lineStart, '\n', chunk.end - lineStart));
+        if(lineEnd == nullptr){
+            lineEnd = chunk.end;
+        }
+        std::string_view line(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        if(!line.empty() && line.back() == '\r'){
+            line.remove_suffix(1);
+        }
+        while(!line.empty() && (line.front() == ' ' || line.front() == '\t')){
+            line.remove_prefix(1);
+        }
+        if(line.empty() || line.compare(0, 2, "//") == 0 || line[0] == '#'){
+            continue;
+        }
+
+        std::string_view position = epdPosition(line);
+
+        Board board;
+        FenError error = board.parseFEN(position);
+        if(error != FEN_OK){
+            chunk.output.append(line.data(), line.size());
+            chunk.output += " ;error ";
+            chunk.output += fenErrorMessage(error);
+            chunk.output += "\n";
+            continue;
+        }
+        //The table is isolated, so this search sees none of the entries left by the positions before it
+        std::unique_ptr<Search> search(new Search(board, limits, {}, 1, table));
+        PackedMove bestMove = search->think();
+
+        char fen[FEN_BUFFER_SIZE];
+        chunk.output.append(fen, board.writeFEN(fen, sizeof(fen)));
+        chunk.output += " ;bestmove ";
+        chunk.output += bestMove.isNull() ? "0000" : board.moveToString(bestMove);
+        chunk.output += " ;score " + formatScore(search->getScore());
+        chunk.output += " ;nodes " + std::to_string(search->getNodes()) + "\n";
+        chunk.nodes += search->getNodes();
+        chunk.positions++;
+    }
+}
+
+static void analysisWorker(AnalysisState& state){
+    std::unique_ptr<TranspositionTable> table(new TranspositionTable(state.hashMegabytes, true));
+    while(true){
+        size_t index = state.nextChunk.fetch_add(1);
+        if(index >= state.chunks.size()){
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> lock(state.mutex);
+            state.changed.wait(lock, [&state, index]{ return index < state.written + state.window; });
+        }
+
+        analyzeChunk(state.chunks[index], *state.limits, *table);
+
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.chunks[index].done = true;
+        }
+        state.changed.notify_all();
+    }
+}
+
+int runBatchAnalysis(const std::string& inputPath, const std::string& outputPath, const SearchLimits& limits, int threadCount, size_t hashMegabytes){
+    int file = open(inputPath.c_str(), O_RDONLY);
+    if(file < 0){
+        std::cout << "Failed to open " << inputPath << std::endl;
+        return 1;
+    }
+    struct stat status;
+    if(fstat(file, &status) != 0){
+        close(file);
+        std::cout << "Failed to open " << inputPath << std::endl;
+        return 1;
+    }
+    size_t size = size_t(status.st_size);
+    void* mapping = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0) : nullptr;
+    close(file);
+    if(mapping == MAP_FAILED){
+        std::cout << "Failed to map " << inputPath << std::endl;
+        return 1;
+    }
+    if(mapping != nullptr){
+        //Read front to back exactly once
+        madvise(mapping, size, MADV_SEQUENTIAL);
+    }
+
+    std::ofstream output(outputPath, std::ios::binary);
+    if(!output.is_open()){
+        if(mapping != nullptr){
+            munmap(mapping, size);
+        }
+        std::cout << "Failed to open " << outputPath << std::endl;
+        return 1;
+    }
+
+    threadCount = std::max(1, threadCount);
+    size_t chunkBytes = std::max(MIN_CHUNK_BYTES, std::min(MAX_CHUNK_BYTES, size / (CHUNKS_PER_THREAD * threadCount)));
+
+    AnalysisState state;
+    const char* text = static_cast<const char*>(mapping);
+    state.chunks = splitLines(text, text + size, chunkBytes);
+    state.window = CHUNK_WINDOW_PER_THREAD * threadCount;
+
+    SearchLimits workerLimits = limits;
+    workerLimits.silent = true;
+    state.limits = &workerLimits;
+    state.hashMegabytes = hashMegabytes;
+
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for(int worker = 0; worker < threadCount; worker++){
+        workers.emplace_back(analysisWorker, std::ref(state));
+    }
+
+    //Write each chunk once it and every chunk before it are done, then let the workers move on
+    uint64_t totalNodes = 0;
+    int totalPositions = 0;
+    for(size_t index = 0; index < state.chunks.size(); index++){
+        AnalysisChunk& chunk = state.chunks[index];
+        {
+            std::unique_lock<std::mutex> lock(state.mutex);
+            state.changed.wait(lock, [&chunk]{ return chunk.done; });
+        }
+        output.write(chunk.output.data(), chunk.output.size());
+        output.flush();
+        totalNodes += chunk.nodes;
+        totalPositions += chunk.positions;
+        std::string().swap(chunk.output);
+
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.written = index + 1;
+        }
+        state.changed.notify_all();
+    }
+
+    for(std::thread& worker : workers){
+        worker.join();
+    }
+    if(mapping != nullptr){
+        munmap(mapping, size);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Analyzed " << totalPositions << " positions with " << threadCount << " threads"
+              << "  nodes " << totalNodes
+              << "  time " << static_cast<uint64_t>(seconds * 1000) << " ms"
+              << "  nps " << static_cast<uint64_t>(seconds > 0 ? totalNodes / seconds : 0)
+              << "  positions/s " << static_cast<uint64_t>(seconds > 0 ? totalPositions / seconds : 0) << std::endl;
+    return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef ANALYZE_H
+#define ANALYZE_H
+
+#include <string>
+
+#include "search.h"
+
+//Hash per analysis worker in megabytes. Batch searches are short, a small table is enough
+const size_t DEFAULT_ANALYSIS_HASH = 16;
+
+/**
+ * Batch analysis: searches every position of an EPD or FEN file with the
+ * given limits (normally a fixed depth or node count) and writes one result
+ * line per position to outputPath, in input order:
+ *
+ *   <position> ;bestmove e2e4 ;score cp 25 ;nodes 123456
+ *
+ * The input is memory-mapped and split into line-aligned chunks that a pool
+ * of threadCount workers takes in turn, each running its own single-threaded
+ * search. Each worker has its own isolated transposition table of
+ * hashMegabytes, so memory is threadCount * hashMegabytes, and no search sees
+ * entries from the positions before it. Results are therefore the same for any
+ * thread count and input order, with nothing cleared between positions.
+ * Finished chunks are written as soon as every chunk before them is,
+ * so results stream out while later chunks are still being searched.
+ *
+ * Empty lines and lines starting with "//" or "#" are skipped. A position
+ * that cannot be read gets ";error <reason>" instead of a result.
+ * Returns 0 on success, 1 if a file could not be opened.
+*/
+int runBatchAnalysis(const std::string& inputPath, const std::string& outputPath, const SearchLimits& limits, int threadCount,
+                     size_t hashMegabytes = DEFAULT_ANALYSIS_HASH);
+
+#endif  // ANALYZE_H
@@ -0,0 +1,189 @@
+#include <cstdlib>
+
+#include "bitboard.h"
+
+Magic bishopMagics[64];
+Magic rookMagics[64];
+bool usePext = false;
+
+Bitboard knightAttacks[64];
+Bitboard kingAttacks[64];
+Bitboard pawnAttacks[2][64];
+Bitboard betweenBB[64][64];
+Bitboard lineBB[64][64];
+
+//Every square's slice of the shared tables, sized 2^(relevant occupancy bits)
+static Bitboard bishopTable[0x1480];
+static Bitboard rookTable[0x19000];
+
+/**
+ * Reference slider attacks, walking each ray until it leaves the board or
+ * hits a blocker. Only used to fill the lookup tables.
+*/
+static Bitboard slidingAttacks(int squareIndex, Bitboard occupied, const int directions[4][2]){
+    Bitboard attacks = 0;
+    int rank = squareIndex / 8;
+    int file = squareIndex % 8;
+
+    for(int direction = 0; direction < 4; direction++){
+        int targetRank = rank + directions[direction][0];
+        int targetFile = file + directions[direction][1];
+
+        while(targetRank >= 0 && targetRank < 8 && targetFile >= 0 && targetFile < 8){
+            Bitboard target = squareBB(targetRank * 8 + targetFile);
+            attacks |= target;
+            if(occupied & target){
+                break;  //Blocker is attacked but nothing behind it
+            }
+            targetRank += directions[direction][0];
+            targetFile += directions[direction][1];
+        }
+    }
+    return attacks;
+}
+
+/**
+ * xorshift64* generator. Magics are found from fixed seeds so the tables
+ * come out identical on every run.
+*/
+static uint64_t nextRandom(uint64_t& state){
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+//Magic candidates work best with few bits set
+static uint64_t sparseRandom(uint64_t& state){
+    return nextRandom(state) & nextRandom(state) & nextRandom(state);
+}
+
+static void initSliderTable(Magic magics[64], Bitboard* table, const int directions[4][2]){
+    //Seeds per rank known to converge quickly
+    const uint64_t seeds[8] = {728, 10316, 55013, 32803, 12281, 15100, 16645, 255};
+
+    Bitboard occupancies[4096];
+    Bitboard references[4096];
+    int epoch[4096] = {};
+    int attempt = 0;
+
+    for(int squareIndex = 0; squareIndex < 64; squareIndex++){
+        int rank = squareIndex / 8;
+        int file = squareIndex % 8;
+
+        //Edge squares never block anything further along the ray, so leave them out of the mask
+        Bitboard edges = ((RANK_1_BB | RANK_8_BB) & ~(RANK_1_BB << (8 * rank)))
+                       | ((FILE_A_BB | FILE_H_BB) & ~(FILE_A_BB << file));
+
+        Magic& magic = magics[squareIndex];
+        magic.mask = slidingAttacks(squareIndex, 0, directions) & ~edges;
+        magic.shift = 64 - popCount(magic.mask);
+        magic.attacks = (squareIndex == 0) ? table : magics[squareIndex - 1].attacks + (1 << (64 - magics[squareIndex - 1].shift));
+
+        //Enumerate every subset of the mask (Carry-Rippler) along with its true attack set
+        int size = 0;
+        Bitboard subset = 0;
+        do{
+            occupancies[size] = subset;
+            references[size] = slidingAttacks(squareIndex, subset, directions);
+            if(usePext){
+                magic.attacks[pextIndex(subset, magic.mask)] = references[size];
+            }
+            size++;
+            subset = (subset - magic.mask) & magic.mask;
+        } while(subset);
+
+        if(usePext){
+            continue;
+        }
+
+        uint64_t state = seeds[rank];
+        for(int i = 0; i < size; ){
+            magic.magic = 0;
+            while(popCount((magic.mask * magic.magic) >> 56) < 6){
+                magic.magic = sparseRandom(state);
+            }
+
+            //A magic is good if no two occupancies with different attacks share an index.
+            //epoch[] marks which slots were written during this attempt, avoiding a clear per try
+            attempt++;
+            for(i = 0; i < size; i++){
+                unsigned index = magic.index(occupancies[i]);
+                if(epoch[index] < attempt){
+                    epoch[index] = attempt;
+                    magic.attacks[index] = references[i];
+                }
+                else if(magic.attacks[index] != references[i]){
+                    break;
+                }
+            }
+        }
+    }
+}
+
+//Squares reached by a single step of each offset that stays on the board
+static Bitboard leaperAttacks(int squareIndex, const int offsets[][2], int offsetCount){
+    Bitboard attacks = 0;
+    int rank = squareIndex / 8;
+    int file = squareIndex % 8;
+    for(int offset = 0; offset < offsetCount; offset++){
+        int targetRank = rank + offsets[offset][0];
+        int targetFile = file + offsets[offset][1];
+        if(targetRank >= 0 && targetRank < 8 && targetFile >= 0 && targetFile < 8){
+            attacks |= squareBB(targetRank * 8 + targetFile);
+        }
+    }
+    return attacks;
+}
+
+static void initLeaperTables(){
+    const int knightOffsets[8][2] = {{2, 1}, {2, -1}, {-2, 1}, {-2, -1}, {1, 2}, {1, -2}, {-1, 2}, {-1, -2}};
+    const int kingOffsets[8][2] = {{1, 1}, {1, 0}, {1, -1}, {0, 1}, {0, -1}, {-1, 1}, {-1, 0}, {-1, -1}};
+    const int whitePawnOffsets[2][2] = {{1, 1}, {1, -1}};
+    const int blackPawnOffsets[2][2] = {{-1, 1}, {-1, -1}};
+
+    for(int squareIndex = 0; squareIndex < 64; squareIndex++){
+        knightAttacks[squareIndex] = leaperAttacks(squareIndex, knightOffsets, 8);
+        kingAttacks[squareIndex] = leaperAttacks(squareIndex, kingOffsets, 8);
+        pawnAttacks[0][squareIndex] = leaperAttacks(squareIndex, whitePawnOffsets, 2);
+        pawnAttacks[1][squareIndex] = leaperAttacks(squareIndex, blackPawnOffsets, 2);
+    }
+}
+
+//Needs the slider tables
+static void initLineTables(){
+    for(int first = 0; first < 64; first++){
+        for(int second = 0; second < 64; second++){
+            betweenBB[first][second] = 0;
+            lineBB[first][second] = 0;
+            if(first == second){
+                continue;
+            }
+
+            Bitboard ends = squareBB(first) | squareBB(second);
+            if(bishopAttacks(first, 0) & squareBB(second)){
+                betweenBB[first][second] = bishopAttacks(first, squareBB(second)) & bishopAttacks(second, squareBB(first));
+                lineBB[first][second] = (bishopAttacks(first, 0) & bishopAttacks(second, 0)) | ends;
+            }
+            else if(rookAttacks(first, 0) & squareBB(second)){
+                betweenBB[first][second] = rookAttacks(first, squareBB(second)) & rookAttacks(second, squareBB(first));
+                lineBB[first][second] = (rookAttacks(first, 0) & rookAttacks(second, 0)) | ends;
+            }
+        }
+    }
+}
+
+void initBitboards(){
+    const int bishopDirections[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+    const int rookDirections[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+#if defined(__x86_64__)
+    //PEXT is microcoded and slow on AMD before Zen 3; ALPHAOMEGA_NO_PEXT forces magics
+    usePext = __builtin_cpu_supports("bmi2") && std::getenv("ALPHAOMEGA_NO_PEXT") == nullptr;
+#endif
+
+    initSliderTable(bishopMagics, bishopTable, bishopDirections);
+    initSliderTable(rookMagics, rookTable, rookDirections);
+    initLeaperTables();
+    initLineTables();
+}
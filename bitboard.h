@@ -0,0 +1,102 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/**
+ * A bitboard is a 64 bit set with one bit per square. Bit numbering follows
+ * the mailbox index used by Board: bit 0 is a1, bit 7 is h1 and bit 63 is h8.
+*/
+typedef uint64_t Bitboard;
+
+constexpr Bitboard FILE_A_BB = 0x0101010101010101ULL;
+constexpr Bitboard FILE_H_BB = FILE_A_BB << 7;
+constexpr Bitboard RANK_1_BB = 0xFFULL;
+constexpr Bitboard RANK_8_BB = RANK_1_BB << 56;
+
+inline Bitboard squareBB(int squareIndex){
+    return 1ULL << squareIndex;
+}
+
+inline int popCount(Bitboard bitboard){
+    return __builtin_popcountll(bitboard);
+}
+
+//Index of the lowest set bit. The bitboard must not be empty
+inline int lsb(Bitboard bitboard){
+    return __builtin_ctzll(bitboard);
+}
+
+//Removes the lowest set bit and returns its index
+inline int popLSB(Bitboard& bitboard){
+    int squareIndex = lsb(bitboard);
+    bitboard &= bitboard - 1;
+    return squareIndex;
+}
+
+/**
+ * Slider attacks come from one table lookup per piece. The relevant
+ * occupancy (ray squares minus the board edge) is hashed to a table slot
+ * either by a magic multiply or, on CPUs with BMI2, by PEXT. The choice
+ * is made once at startup by initBitboards.
+*/
+struct Magic {
+    Bitboard mask;
+    Bitboard magic;
+    Bitboard* attacks;
+    unsigned shift;
+
+    unsigned index(Bitboard occupied) const {
+        return unsigned(((occupied & mask) * magic) >> shift);
+    }
+};
+
+extern Magic bishopMagics[64];
+extern Magic rookMagics[64];
+extern bool usePext;
+
+#if defined(__x86_64__)
+__attribute__((target("bmi2")))
+inline unsigned pextIndex(Bitboard occupied, Bitboard mask){
+    return unsigned(_pext_u64(occupied, mask));
+}
+#else
+inline unsigned pextIndex(Bitboard occupied, Bitboard mask){
+    return 0;  //Never called, usePext stays false off x86
+}
+#endif
+
+//Fills the slider, leaper and line tables. Must run once before any attack lookup
+void initBitboards();
+
+extern Bitboard knightAttacks[64];
+extern Bitboard kingAttacks[64];
+extern Bitboard pawnAttacks[2][64];   //[color][square], squares a pawn of that colour captures on
+
+/**
+ * For two squares on a common rank, file or diagonal: betweenBB holds the
+ * squares strictly between them and lineBB the whole line through both.
+ * Both are empty for unaligned squares.
+*/
+extern Bitboard betweenBB[64][64];
+extern Bitboard lineBB[64][64];
+
+inline Bitboard bishopAttacks(int squareIndex, Bitboard occupied){
+    const Magic& magic = bishopMagics[squareIndex];
+    return magic.attacks[usePext ? pextIndex(occupied, magic.mask) : magic.index(occupied)];
+}
+
+inline Bitboard rookAttacks(int squareIndex, Bitboard occupied){
+    const Magic& magic = rookMagics[squareIndex];
+    return magic.attacks[usePext ? pextIndex(occupied, magic.mask) : magic.index(occupied)];
+}
+
+inline Bitboard queenAttacks(int squareIndex, Bitboard occupied){
+    return bishopAttacks(squareIndex, occupied) | rookAttacks(squareIndex, occupied);
+}
+
+#endif  // BITBOARD_H
@@ -1,12 +1,14 @@
+#include <algorithm>
+#include <cstring>
 #include <iostream>
-#include <sstream>
 #include <string>
 #include <vector>
 #include <cmath>
-#include <fstream>
-#include <chrono>
 
 #include "board.h"
+#include "eval.h"
+#include "trace.h"
+#include "zobrist.h"
 
     
 /**
@@ -15,18 +17,16 @@
 */
 Board::Board() {
     // Initialize the board to the starting position
-    for (int squareIndex = 0; squareIndex < 64; squareIndex++) {
-        squares[squareIndex] = Piece::EMPTY;
-    }
-    Board::sideToMove = 'w'; // White to play initially
+    clearBoard();
+    Board::sideToMove = WHITE; // White to play initially
 
     // Casting for white Kingside and Queenside
     // Casting for black kingside and queenside
-    Board::castlingAvailability = "KQkq"; 
-    Board::enPassantTargetSquare = "-";
+    Board::castlingRights = ALL_CASTLING; 
+    Board::enPassantSquare = -1;
     Board::halfMoveClock = 0;
     Board::fullMoveNumber = 1;
-    
+    Board::zobristKey = computeZobristKey();
 }   
 
 /**
@@ -45,16 +45,118 @@ Piece Board::getPiece(int file, int rank){
 }
 
 void Board::setPiece(int rank, int file, Piece piece){
-    int index = rank*8+file;
+    setSquare(rank*8+file, piece);
+}
+
+void Board::setSquare(int index, Piece piece){
     if(piece == KING){
         whiteKingSquare = index;
     }
     else if(piece == BLACK_KING){
         blackKingSquare = index;
     }
+
+    //Take whatever stood on the square out of the bitboards before placing the new piece
+    Bitboard squareMask = squareBB(index);
+    Piece previous = squares[index];
+    if(previous != EMPTY){
+        pieceBitboards[colorOf(previous)][typeOf(previous)] &= ~squareMask;
+        colorBitboards[colorOf(previous)] &= ~squareMask;
+        occupiedBitboard &= ~squareMask;
+        zobristKey ^= zobristKeys.pieces[colorOf(previous)][typeOf(previous)][index];
+        midgameScore -= pieceSquareTables.midgame[colorOf(previous)][typeOf(previous)][index];
+        endgameScore -= pieceSquareTables.endgame[colorOf(previous)][typeOf(previous)][index];
+        gamePhase -= phaseWeights[typeOf(previous)];
+    }
+    if(piece != EMPTY){
+        pieceBitboards[colorOf(piece)][typeOf(piece)] |= squareMask;
+        colorBitboards[colorOf(piece)] |= squareMask;
+        occupiedBitboard |= squareMask;
+        zobristKey ^= zobristKeys.pieces[colorOf(piece)][typeOf(piece)][index];
+        midgameScore += pieceSquareTables.midgame[colorOf(piece)][typeOf(piece)][index];
+        endgameScore += pieceSquareTables.endgame[colorOf(piece)][typeOf(piece)][index];
+        gamePhase += phaseWeights[typeOf(piece)];
+    }
     squares[index]=piece;
 }
 
+/**
+ * Empties every square and resets the bitboards to match
+*/
+void Board::clearBoard(){
+    for(int squareIndex = 0; squareIndex < 64; squareIndex++){
+        squares[squareIndex] = EMPTY;
+    }
+    for(int color = WHITE; color <= BLACK; color++){
+        for(int pieceType = EMPTY; pieceType <= KING; pieceType++){
+            pieceBitboards[color][pieceType] = 0;
+        }
+        colorBitboards[color] = 0;
+    }
+    occupiedBitboard = 0;
+    zobristKey = 0;
+    midgameScore = 0;
+    endgameScore = 0;
+    gamePhase = 0;
+}
+
+/**
+ * Key of the current position built from nothing. setPiece and make/unmake
+ * keep zobristKey up to date incrementally; this is the reference to check
+ * them against.
+*/
+uint64_t Board::computeZobristKey(){
+    uint64_t key = 0;
+    Bitboard occupied = occupiedBitboard;
+    while(occupied){
+        int squareIndex = popLSB(occupied);
+        Piece piece = squares[squareIndex];
+        key ^= zobristKeys.pieces[colorOf(piece)][typeOf(piece)][squareIndex];
+    }
+    key ^= zobristKeys.castling[castlingRights];
+    if(enPassantSquare >= 0){
+        key ^= zobristKeys.enPassantFile[enPassantSquare % 8];
+    }
+    if(sideToMove == BLACK){
+        key ^= zobristKeys.blackToMove;
+    }
+    return key;
+}
+
+uint64_t Board::getZobristKey(){
+    return zobristKey;
+}
+
+/**
+ * Evaluation sums built from nothing, the reference for the incremental
+ * values setSquare maintains
+*/
+void Board::computeEvaluationTerms(int& midgame, int& endgame, int& phase){
+    midgame = 0;
+    endgame = 0;
+    phase = 0;
+    Bitboard occupied = occupiedBitboard;
+    while(occupied){
+        int squareIndex = popLSB(occupied);
+        Piece piece = squares[squareIndex];
+        midgame += pieceSquareTables.midgame[colorOf(piece)][typeOf(piece)][squareIndex];
+        endgame += pieceSquareTables.endgame[colorOf(piece)][typeOf(piece)][squareIndex];
+        phase += phaseWeights[typeOf(piece)];
+    }
+}
+
+int Board::getMidgameScore(){
+    return midgameScore;
+}
+
+int Board::getEndgameScore(){
+    return endgameScore;
+}
+
+int Board::getGamePhase(){
+    return gamePhase;
+}
+
 Piece Board::getPieceFromFENCharacter(char piece){
     switch(piece){
         case 'P': return PAWN;
@@ -73,68 +175,222 @@ Piece Board::getPieceFromFENCharacter(char piece){
     }
 }
 
-void Board::setupPositionFromFEN(const std::string& fen){
-    // Reset the board to its initial state
-    for(int squareIndex =0;squareIndex<64;squareIndex++){
-        squares[squareIndex]=EMPTY;
+/**
+ * Next space separated field of fen from position on, empty at the end
+*/
+static std::string_view nextFenField(std::string_view fen, size_t& position){
+    while(position < fen.size() && fen[position] == ' '){
+        position++;
     }
-    
-    /**
-     * Parse the FEN string and set up the board accordingly
-     * Example: "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
-     * Split the FEN string into tokens
-     * */ 
-    
-    char delimiter = '/';
-    // Vector to store the tokens extracted from the fen notation
-    std::vector<std::string> tokens;
+    size_t start = position;
+    while(position < fen.size() && fen[position] != ' '){
+        position++;
+    }
+    return fen.substr(start, position - start);
+}
 
-    // Stream for the fen notation
-    std::stringstream ss(fen);
+//Whole field as a decimal number no larger than limit
+static bool parseFenNumber(std::string_view field, int limit, int& value){
+    if(field.empty()){
+        return false;
+    }
+    value = 0;
+    for(char digit : field){
+        if(digit < '0' || digit > '9'){
+            return false;
+        }
+        value = value * 10 + (digit - '0');
+        if(value > limit){
+            return false;
+        }
+    }
+    return true;
+}
 
-    std::string short_fen;
-    while(getline(ss,short_fen,' ')){
-        tokens.push_back(short_fen);
+const char* fenErrorMessage(FenError error){
+    switch(error){
+        case FEN_OK:             return "ok";
+        case FEN_BAD_PLACEMENT:  return "bad piece placement";
+        case FEN_BAD_KINGS:      return "each side needs exactly one king";
+        case FEN_BAD_SIDE:       return "side to move must be w or b";
+        case FEN_BAD_CASTLING:   return "bad castling rights";
+        case FEN_BAD_EN_PASSANT: return "bad en passant square";
+        case FEN_BAD_CLOCK:      return "bad move counter";
+        case FEN_TRAILING_INPUT: return "unexpected text after the position";
+        case FEN_OPPONENT_IN_CHECK: return "side not to move is in check";
     }
+    return "unknown error";
+}
 
-    /**
-     * rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR
-     * lowercase is for black
-     * each / represents a new row
-     * numbers = empty squares
-    */
-    
-    // Start with black top left so A7 which is rank 7 file A
-    std::string initialPosition = tokens[0];
+/**
+ * Single pass over the six FEN fields. Everything is checked before the board
+ * is touched, so a malformed FEN leaves the current position as it was. The
+ * move counters may be left out, as in EPD, and default to 0 and 1.
+*/
+FenError Board::parseFEN(std::string_view fen){
+    size_t position = 0;
+
+    //Ranks from 8 down to 1, files a to h within each
+    Piece placement[64] = {};
+    int kingCount[2] = {0, 0};
     int rank = 7;
     int file = 0;
-    for(char piece:initialPosition){
-        if(piece == '/'){
+    std::string_view field = nextFenField(fen, position);
+    if(field.empty()){
+        return FEN_BAD_PLACEMENT;
+    }
+    for(char character : field){
+        if(character == '/'){
+            if(file != 8 || rank == 0){
+                return FEN_BAD_PLACEMENT;
+            }
             rank--;
-            file=0;
+            file = 0;
         }
-        else if(std::isdigit(piece)){
-            int emptySquares = piece - '0';
-            file += emptySquares;
+        else if(character >= '1' && character <= '8'){
+            file += character - '0';
+            if(file > 8){
+                return FEN_BAD_PLACEMENT;
+            }
         }
         else{
-            Piece p = getPieceFromFENCharacter(piece);
-            std::cout<<"Setting up board with piece "<<p<<" using piece "<<piece<<std::endl;
-            setPiece(rank, file, p);
+            Piece piece = getPieceFromFENCharacter(character);
+            if(piece == EMPTY || file > 7){
+                return FEN_BAD_PLACEMENT;
+            }
+            //Pawns never stand on the first or last rank
+            if(typeOf(piece) == PAWN && (rank == 0 || rank == 7)){
+                return FEN_BAD_PLACEMENT;
+            }
+            if(typeOf(piece) == KING){
+                kingCount[colorOf(piece)]++;
+            }
+            placement[rank * 8 + file] = piece;
             file++;
         }
     }
+    if(rank != 0 || file != 8){
+        return FEN_BAD_PLACEMENT;
+    }
+    if(kingCount[WHITE] != 1 || kingCount[BLACK] != 1){
+        return FEN_BAD_KINGS;
+    }
+
+    field = nextFenField(fen, position);
+    if(field != "w" && field != "b"){
+        return FEN_BAD_SIDE;
+    }
+    char side = field[0];
 
-    sideToMove=tokens[1][0];
-    castlingAvailability=tokens[2];
-    enPassantTargetSquare=tokens[3];
-    halfMoveClock=std::stoi(tokens[4]);
-    fullMoveNumber=std::stoi(tokens[5]);
+    //Each right needs its king and rook still on their starting squares
+    uint8_t rights = 0;
+    field = nextFenField(fen, position);
+    if(field.empty()){
+        return FEN_BAD_CASTLING;
+    }
+    if(field != "-"){
+        for(char right : field){
+            uint8_t bit;
+            bool inPlace;
+            switch(right){
+                case 'K': bit = WHITE_KINGSIDE;  inPlace = placement[4] == KING && placement[7] == ROOK; break;
+                case 'Q': bit = WHITE_QUEENSIDE; inPlace = placement[4] == KING && placement[0] == ROOK; break;
+                case 'k': bit = BLACK_KINGSIDE;  inPlace = placement[60] == BLACK_KING && placement[63] == BLACK_ROOK; break;
+                case 'q': bit = BLACK_QUEENSIDE; inPlace = placement[60] == BLACK_KING && placement[56] == BLACK_ROOK; break;
+                default: return FEN_BAD_CASTLING;
+            }
+            if((rights & bit) || !inPlace){
+                return FEN_BAD_CASTLING;
+            }
+            rights |= bit;
+        }
+    }
 
-    for(const auto& token:tokens){
-        std::cout << token << std::endl;
+    //The target lies behind a pawn that just advanced two squares
+    int enPassant = -1;
+    field = nextFenField(fen, position);
+    if(field.empty()){
+        return FEN_BAD_EN_PASSANT;
     }
-                
+    if(field != "-"){
+        char targetRank = (side == 'w') ? '6' : '3';
+        if(field.size() != 2 || field[0] < 'a' || field[0] > 'h' || field[1] != targetRank){
+            return FEN_BAD_EN_PASSANT;
+        }
+        enPassant = (field[1] - '1') * 8 + (field[0] - 'a');
+        int pawnSquare = (side == 'w') ? enPassant - 8 : enPassant + 8;
+        if(placement[pawnSquare] != ((side == 'w') ? BLACK_PAWN : PAWN)){
+            return FEN_BAD_EN_PASSANT;
+        }
+    }
+
+    int halfMoves = 0;
+    int fullMoves = 1;
+    field = nextFenField(fen, position);
+    if(!field.empty()){
+        if(!parseFenNumber(field, MAX_HALF_MOVE_CLOCK, halfMoves)){
+            return FEN_BAD_CLOCK;
+        }
+        field = nextFenField(fen, position);
+        if(!parseFenNumber(field, 0xFFFF, fullMoves)){
+            return FEN_BAD_CLOCK;
+        }
+        //Some writers start counting at 0
+        fullMoves = std::max(fullMoves, 1);
+    }
+    if(!nextFenField(fen, position).empty()){
+        return FEN_TRAILING_INPUT;
+    }
+
+    //Built aside first, the side not to move being in check can only be seen on a set up board
+    Board candidate = *this;
+    candidate.clearBoard();
+    for(int squareIndex = 0; squareIndex < 64; squareIndex++){
+        if(placement[squareIndex] != EMPTY){
+            TRACE(TRACE_DEBUG, "Setting up board with piece "<<int(placement[squareIndex])<<" on "<<squareIndex);
+            candidate.setSquare(squareIndex, placement[squareIndex]);
+        }
+    }
+    Color us = (side == 'w') ? WHITE : BLACK;
+    int theirKing = (us == WHITE) ? candidate.blackKingSquare : candidate.whiteKingSquare;
+    if(candidate.isSquareAttacked(theirKing, us)){
+        return FEN_OPPONENT_IN_CHECK;
+    }
+    candidate.sideToMove = us;
+    candidate.castlingRights = rights;
+    candidate.enPassantSquare = enPassant;
+    candidate.halfMoveClock = halfMoves;
+    candidate.fullMoveNumber = fullMoves;
+    candidate.zobristKey = candidate.computeZobristKey();
+    *this = candidate;
+    TRACE(TRACE_INFO, "Position set up from " << fen);
+    return FEN_OK;
+}
+
+//Whole field made of digits, whatever its value
+static bool isFenNumber(std::string_view field){
+    return !field.empty() && std::all_of(field.begin(), field.end(), [](char digit){ return digit >= '0' && digit <= '9'; });
+}
+
+std::string_view epdPosition(std::string_view line){
+    line = line.substr(0, line.find(';'));
+    size_t position = 0;
+    for(int field = 0; field < 4; field++){
+        nextFenField(line, position);
+    }
+    size_t end = position;
+
+    //Counters only when both are there, anything else is the first operation
+    std::string_view halfMoves = nextFenField(line, position);
+    std::string_view fullMoves = nextFenField(line, position);
+    if(isFenNumber(halfMoves) && isFenNumber(fullMoves)){
+        end = position;
+    }
+    return line.substr(0, end);
+}
+
+bool Board::setupPositionFromFEN(std::string_view fen){
+    return parseFEN(fen) == FEN_OK;
 }
 
 void Board::printBoard(){
@@ -190,98 +446,283 @@ void Board::printBoard(){
     }
 }
 
+/**
+ * Read-only view of the mailbox. Writing through this pointer bypasses
+ * setPiece and leaves the bitboards out of sync.
+*/
 Piece* Board::getSquares(){
     return squares;
 }
 
-std::string Board::exportFEN() {
-    std::string FEN = "";
-    int emptyCount = 0;
+Bitboard Board::getPieces(Color color, int pieceType){
+    return pieceBitboards[color][pieceType];
+}
 
-    for (int rank = 7; rank >= 0; rank--) {
-        for (int file = 0; file < 8; file++) {
-            int tile = rank * 8 + file;
-            Piece piece = squares[tile];
+Bitboard Board::getColorPieces(Color color){
+    return colorBitboards[color];
+}
 
-            if (piece == EMPTY) {
-                emptyCount++;
-            } else {
-                if (emptyCount > 0) {
-                    FEN += std::to_string(emptyCount);
-                    emptyCount = 0;
-                }
+Bitboard Board::getOccupied(){
+    return occupiedBitboard;
+}
 
-                switch (piece) {
-                    case PAWN:
-                        FEN += 'P';
-                        break;
-                    case KNIGHT:
-                        FEN += 'N';
-                        break;
-                    case BISHOP:
-                        FEN += 'B';
-                        break;
-                    case ROOK:
-                        FEN += 'R';
-                        break;
-                    case QUEEN:
-                        FEN += 'Q';
-                        break;
-                    case KING:
-                        FEN += 'K';
-                        break;
-                    case BLACK_PAWN:
-                        FEN += 'p';
-                        break;
-                    case BLACK_KNIGHT:
-                        FEN += 'n';
-                        break;
-                    case BLACK_BISHOP:
-                        FEN += 'b';
-                        break;
-                    case BLACK_ROOK:
-                        FEN += 'r';
-                        break;
-                    case BLACK_QUEEN:
-                        FEN += 'q';
-                        break;
-                    case BLACK_KING:
-                        FEN += 'k';
-                        break;
-                }
+//Writes value in decimal at out and returns the end
+static char* writeFenNumber(char* out, int value){
+    char digits[12];
+    int count = 0;
+    do{
+        digits[count++] = char('0' + value % 10);
+        value /= 10;
+    } while(value > 0);
+    while(count > 0){
+        *out++ = digits[--count];
+    }
+    return out;
+}
+
+/**
+ * Writes the position as FEN into buffer, NUL terminated, without touching
+ * the heap. Returns the length written, or 0 if capacity is too small.
+ * FEN_BUFFER_SIZE is always enough.
+*/
+size_t Board::writeFEN(char* buffer, size_t capacity){
+    static const char pieceCharacters[] = "kqrbnp.PNBRQK";  //Indexed by piece + KING
+    char text[FEN_BUFFER_SIZE];
+    char* out = text;
+
+    for(int rank = 7; rank >= 0; rank--){
+        int emptyCount = 0;
+        for(int file = 0; file < 8; file++){
+            Piece piece = squares[rank * 8 + file];
+            if(piece == EMPTY){
+                emptyCount++;
+                continue;
+            }
+            if(emptyCount > 0){
+                *out++ = char('0' + emptyCount);
+                emptyCount = 0;
             }
+            *out++ = pieceCharacters[piece + KING];
         }
-
-        if (emptyCount > 0) {
-            FEN += std::to_string(emptyCount);
-            emptyCount = 0;
+        if(emptyCount > 0){
+            *out++ = char('0' + emptyCount);
+        }
+        if(rank > 0){
+            *out++ = '/';
         }
+    }
+
+    *out++ = ' ';
+    *out++ = (sideToMove == WHITE) ? 'w' : 'b';
+
+    *out++ = ' ';
+    if(castlingRights == 0){
+        *out++ = '-';
+    }
+    if(castlingRights & WHITE_KINGSIDE)  *out++ = 'K';
+    if(castlingRights & WHITE_QUEENSIDE) *out++ = 'Q';
+    if(castlingRights & BLACK_KINGSIDE)  *out++ = 'k';
+    if(castlingRights & BLACK_QUEENSIDE) *out++ = 'q';
+
+    *out++ = ' ';
+    if(enPassantSquare < 0){
+        *out++ = '-';
+    }
+    else{
+        *out++ = char('a' + enPassantSquare % 8);
+        *out++ = char('1' + enPassantSquare / 8);
+    }
 
-        if (rank > 0) {
-            FEN += '/';
+    *out++ = ' ';
+    out = writeFenNumber(out, halfMoveClock);
+    *out++ = ' ';
+    out = writeFenNumber(out, fullMoveNumber);
+
+    size_t length = out - text;
+    if(length + 1 > capacity){
+        return 0;
+    }
+    std::memcpy(buffer, text, length);
+    buffer[length] = '\0';
+    return length;
+}
+
+std::string Board::exportFEN() {
+    char buffer[FEN_BUFFER_SIZE];
+    return std::string(buffer, writeFEN(buffer, sizeof(buffer)));
+}
+
+bool Board::storePacked(PackedPosition& packed){
+    if(popCount(occupiedBitboard) > 32 || halfMoveClock > MAX_HALF_MOVE_CLOCK){
+        return false;
+    }
+    packed = PackedPosition();
+    packed.occupancy = occupiedBitboard;
+
+    Bitboard occupied = occupiedBitboard;
+    for(int index = 0; occupied; index++){
+        Piece piece = squares[popLSB(occupied)];
+        uint8_t code = uint8_t(typeOf(piece) - PAWN + (colorOf(piece) == BLACK ? 6 : 0));
+        packed.pieces[index / 2] |= uint8_t(code << (4 * (index % 2)));
+    }
+
+    packed.state = uint8_t(sideToMove | (castlingRights << 1));
+    packed.enPassantSquare = enPassantSquare < 0 ? PackedPosition::NO_EN_PASSANT : uint8_t(enPassantSquare);
+    packed.halfMoveClock = uint16_t(halfMoveClock);
+    packed.fullMoveNumber = uint16_t(fullMoveNumber);
+    return true;
+}
+
+/**
+ * The key and both piece-square values for every PackedPosition piece code on
+ * every square side by side, so loadPacked reads one entry per piece instead
+ * of three tables indexed by colour and type.
+*/
+struct PackedPieceTerms {
+    uint64_t key;
+    int32_t midgame;
+    int32_t endgame;
+};
+
+struct PackedPieceTable {
+    PackedPieceTerms terms[12][64];  //[piece code][square]
+
+    PackedPieceTable(){
+        for(int code = 0; code < 12; code++){
+            int color = code >= 6 ? BLACK : WHITE;
+            int pieceType = code % 6 + PAWN;
+            for(int squareIndex = 0; squareIndex < 64; squareIndex++){
+                terms[code][squareIndex].key = zobristKeys.pieces[color][pieceType][squareIndex];
+                terms[code][squareIndex].midgame = pieceSquareTables.midgame[color][pieceType][squareIndex];
+                terms[code][squareIndex].endgame = pieceSquareTables.endgame[color][pieceType][squareIndex];
+            }
         }
     }
+};
+
+//Both source tables are built at compile time, so filling this one during static initialisation is safe
+static const PackedPieceTable packedPieceTerms;
 
-    // Append additional FEN information
-    FEN += " " + std::string(1,sideToMove);// Convert the char to a string
-    FEN += " " + castlingAvailability;
-    FEN += " " + enPassantTargetSquare; //En passant target square (- or e3)
-    FEN += " " + std::to_string(halfMoveClock);
-    FEN += " " + std::to_string(fullMoveNumber);
+/**
+ * Fills the board directly rather than through setSquare, summing keys and
+ * evaluation terms on the way, since loading is the hot path when reading
+ * datasets. A record parseFEN would reject (kings, pawn ranks, castling
+ * rights, en passant, clock, side not to move in check) is only noticed once the pieces are in, and leaves the
+ * board empty.
+*/
+bool Board::loadPacked(const PackedPosition& packed){
+    static const Piece pieceCodes[16] = {
+        PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING,
+        BLACK_PAWN, BLACK_KNIGHT, BLACK_BISHOP, BLACK_ROOK, BLACK_QUEEN, BLACK_KING,
+        EMPTY, EMPTY, EMPTY, EMPTY
+    };
+    int pieceCount = popCount(packed.occupancy);
+    if(pieceCount > 32 || packed.enPassantSquare > PackedPosition::NO_EN_PASSANT || (packed.state >> 5) != 0){
+        return false;
+    }
+    //Codes 12-15 are the nibbles with both top bits set
+    uint64_t nibbles[2];
+    std::memcpy(nibbles, packed.pieces, sizeof(nibbles));
+    if(((nibbles[0] & (nibbles[0] << 1)) | (nibbles[1] & (nibbles[1] << 1))) & 0x8888888888888888ULL){
+        return false;
+    }
 
-    return FEN;
+    std::memset(squares, 0, sizeof(squares));
+    std::memset(pieceBitboards, 0, sizeof(pieceBitboards));
+    occupiedBitboard = packed.occupancy;
+    uint64_t key = 0;
+    int midgame = 0;
+    int endgame = 0;
+
+    //Sixteen codes per word, lowest nibble first
+    Bitboard occupied = packed.occupancy;
+    for(int half = 0; half < 2; half++){
+        uint64_t codes = nibbles[half];
+        int count = std::min(16, pieceCount - 16 * half);
+        for(int index = 0; index < count; index++, codes >>= 4){
+            int squareIndex = popLSB(occupied);
+            int code = int(codes & 15);
+            int black = code >= 6;
+            squares[squareIndex] = pieceCodes[code];
+            pieceBitboards[black][code - 6 * black + PAWN] |= squareBB(squareIndex);
+            const PackedPieceTerms& terms = packedPieceTerms.terms[code][squareIndex];
+            key ^= terms.key;
+            midgame += terms.midgame;
+            endgame += terms.endgame;
+        }
+    }
+    //Colour sets and phase from the finished piece sets rather than per piece
+    int phase = 0;
+    for(int color = WHITE; color <= BLACK; color++){
+        const Bitboard* pieces = pieceBitboards[color];
+        colorBitboards[color] = pieces[PAWN] | pieces[KNIGHT] | pieces[BISHOP] | pieces[ROOK] | pieces[QUEEN] | pieces[KING];
+        phase += popCount(pieces[KNIGHT]) * phaseWeights[KNIGHT] + popCount(pieces[BISHOP]) * phaseWeights[BISHOP]
+               + popCount(pieces[ROOK]) * phaseWeights[ROOK] + popCount(pieces[QUEEN]) * phaseWeights[QUEEN];
+    }
+    //The same rules parseFEN applies: one king a side, no pawns on the first or last rank,
+    //castling rights only with king and rook at home, en passant behind a pawn that just moved two squares
+    Color side = Color(packed.state & 1);
+    uint8_t rights = uint8_t(packed.state >> 1);
+    Bitboard whiteHome = pieceBitboards[WHITE][KING] & squareBB(4);
+    Bitboard blackHome = pieceBitboards[BLACK][KING] & squareBB(60);
+    uint8_t rightsInPlace = uint8_t((whiteHome && (pieceBitboards[WHITE][ROOK] & squareBB(7))) * WHITE_KINGSIDE
+                                  | (whiteHome && (pieceBitboards[WHITE][ROOK] & squareBB(0))) * WHITE_QUEENSIDE
+                                  | (blackHome && (pieceBitboards[BLACK][ROOK] & squareBB(63))) * BLACK_KINGSIDE
+                                  | (blackHome && (pieceBitboards[BLACK][ROOK] & squareBB(56))) * BLACK_QUEENSIDE);
+    bool valid = popCount(pieceBitboards[WHITE][KING]) == 1 && popCount(pieceBitboards[BLACK][KING]) == 1
+              && !((pieceBitboards[WHITE][PAWN] | pieceBitboards[BLACK][PAWN]) & (RANK_1_BB | RANK_8_BB))
+              && !(rights & ~rightsInPlace)
+              && packed.halfMoveClock <= MAX_HALF_MOVE_CLOCK;
+    if(packed.enPassantSquare != PackedPosition::NO_EN_PASSANT){
+        int targetRank = (side == WHITE) ? 5 : 2;
+        int pawnSquare = packed.enPassantSquare + ((side == WHITE) ? -8 : 8);
+        valid = valid && packed.enPassantSquare / 8 == targetRank
+                      && squares[pawnSquare] == ((side == WHITE) ? BLACK_PAWN : PAWN);
+    }
+    Color them = (side == WHITE) ? BLACK : WHITE;
+    valid = valid && !isSquareAttacked(lsb(pieceBitboards[them][KING]), side);
+    if(!valid){
+        clearBoard();
+        return false;
+    }
+    whiteKingSquare = lsb(pieceBitboards[WHITE][KING]);
+    blackKingSquare = lsb(pieceBitboards[BLACK][KING]);
+    midgameScore = midgame;
+    endgameScore = endgame;
+    gamePhase = phase;
+
+    sideToMove = side;
+    castlingRights = rights;
+    enPassantSquare = packed.enPassantSquare == PackedPosition::NO_EN_PASSANT ? -1 : packed.enPassantSquare;
+    halfMoveClock = packed.halfMoveClock;
+    fullMoveNumber = std::max<uint16_t>(packed.fullMoveNumber, 1);
+
+    key ^= zobristKeys.castling[castlingRights];
+    if(enPassantSquare >= 0){
+        key ^= zobristKeys.enPassantFile[enPassantSquare % 8];
+    }
+    if(sideToMove == BLACK){
+        key ^= zobristKeys.blackToMove;
+    }
+    zobristKey = key;
+    return true;
 }
 
 std::string Board::getSideToMove(){
-    return std::string(1,sideToMove);
+    return (sideToMove == WHITE) ? "w" : "b";
 }
 
 std::string Board::getCastlingAvailability(){
-    return castlingAvailability;
+    std::string castling = "";
+    if(castlingRights & WHITE_KINGSIDE)  castling += 'K';
+    if(castlingRights & WHITE_QUEENSIDE) castling += 'Q';
+    if(castlingRights & BLACK_KINGSIDE)  castling += 'k';
+    if(castlingRights & BLACK_QUEENSIDE) castling += 'q';
+    return castling.empty() ? "-" : castling;
 }
 
 std::string Board::getEnPassantTargetSquare(){
-    return enPassantTargetSquare;
+    return enPassantSquare < 0 ? "-" : numericToAlgebraic(enPassantSquare);
 }
 
 int Board::getHalfMoveClock(){
@@ -292,594 +733,629 @@ int Board::getFullMoveNumber(){
     return fullMoveNumber;
 }
 
-void Board::validPawnmove(std::vector<Move>& legalMoves, int rank, int file, int squareIndex){
-    //If the pawn is on the first rank, it has the chance to:
-    //move once, move twice, capture if possible
-    //This determines if we are moving forward as white or black. Refer to BoardIndex.png for insight
-    int forwardDirection = (sideToMove == 'w')?1:-1;
-    std::cout<<"Current Rank: "<<rank<<std::endl;
-    std::cout<<"Current File: "<<file<<std::endl;
-
-    // ===================================================================
+/**
+ * Pawn pushes, double pushes, captures and promotions for the pawn on
+ * squareIndex, keeping only targets inside targetMask. En passant is checked
+ * separately by isLegalEnPassant since it removes a pawn off the target square.
+ * Promotions count as captures for Type, the other pushes as quiet moves.
+ * Direction and ranks come from Us at compile time. Refer to BoardIndex.png for the square layout
+*/
+template<Color Us, GenType Type>
+void Board::validPawnmove(MoveList& legalMoves, int squareIndex, Bitboard targetMask){
+    constexpr Color Them = (Us == WHITE) ? BLACK : WHITE;
+    constexpr int Forward = (Us == WHITE) ? 8 : -8;
+    constexpr int StartRank = (Us == WHITE) ? 1 : 6;
+    constexpr int PromotionRank = (Us == WHITE) ? 7 : 0;
+    constexpr bool Captures = (Type != GEN_QUIETS);
+    constexpr bool Quiets = (Type != GEN_CAPTURES);
 
                                 /* Move up one tile */
-    int targetSquare = squareIndex+forwardDirection*8;
+    int targetSquare = squareIndex+Forward;
+    bool promotion = (targetSquare/8 == PromotionRank);
     if(squares[targetSquare]==EMPTY){
-        //Target square is empty so it is a legal move.
-        //Struct initialization with what kind of move was made
-        int targetRank = targetSquare/8;
-        if(sideToMove=='w'){
-            if(targetRank==7){
-                for (Piece promotionPiece : {QUEEN, ROOK, BISHOP, KNIGHT}) {
-                    Move promotionMove{squareIndex, targetSquare, PAWN, EMPTY, PROMOTION};
-                    promotionMove.promotedPiece = promotionPiece;
-                    legalMoves.emplace_back(promotionMove);
-                }
-            }
-            else{
-                Move pawn{squareIndex,targetSquare,PAWN,EMPTY,NORMAL};
-                legalMoves.emplace_back(pawn);
-            }
-        }
-        else{
-            if(targetRank==0){
-                for (Piece promotionPiece : {BLACK_QUEEN, BLACK_ROOK, BLACK_BISHOP, BLACK_KNIGHT}) {
-                    Move promotionMove{squareIndex, targetSquare, PAWN, EMPTY, PROMOTION};
-                    promotionMove.promotedPiece = promotionPiece;
-                    legalMoves.emplace_back(promotionMove);
+        if((targetMask & squareBB(targetSquare)) && (promotion ? Captures : Quiets)){
+            if(promotion){
+                for(int promotionPiece : {QUEEN, ROOK, BISHOP, KNIGHT}){
+                    legalMoves.push_back(PackedMove(squareIndex, targetSquare, PackedMove::PROMOTION_FLAG, promotionPiece));
                 }
             }
             else{
-                Move pawn{squareIndex,targetSquare,BLACK_PAWN,EMPTY,NORMAL};
-                legalMoves.emplace_back(pawn);
-            }
-        }
-            std::cout<<"[1] Moving 1 tile up "<<squareIndex<<std::endl;
-    }                
-
-    // ===================================================================
-
-                            /* Capture piece */
-    if(file==0){ //A file
-        //As white, assume tile is 48. Capture can happen on 41
-        //As black, assume tile is 8. Capture can happen on 17
-        int targetSquare = 0;
-        if (sideToMove == 'w')
-            //white to capture
-            targetSquare = squareIndex + forwardDirection * 9;  // Capture to the right
-        else
-            //black to capture
-            targetSquare = squareIndex + forwardDirection * 7;  // Capture to the left
-
-        if (targetSquare >= 0 && targetSquare <= 63) {
-            //target is still on the board
-            Piece capturedPiece = squares[targetSquare];
-            int targetRank = targetSquare/8;
-
-            // Check if the captured piece is of the opposite color
-            if (capturedPiece != EMPTY && capturedPiece * forwardDirection < 0 && targetRank!=rank) {
-                if(sideToMove=='w'){
-                    if(targetRank==7){
-                        for (Piece promotionPiece : {QUEEN, ROOK, BISHOP, KNIGHT}) {
-                            Move promotionMove{squareIndex, targetSquare, PAWN, capturedPiece, PROMOTION_CAPTURE};
-                            promotionMove.promotedPiece = promotionPiece;
-                            legalMoves.emplace_back(promotionMove);
-                        }
-                    }
-                    else{               
-                        Move capture{squareIndex,targetSquare,PAWN,capturedPiece,CAPTURE};
-                        legalMoves.emplace_back(capture);
-                    }
-                }
-                else{
-                    if(targetRank==0){
-                        for (Piece promotionPiece : {BLACK_QUEEN, BLACK_ROOK, BLACK_BISHOP, BLACK_KNIGHT}) {
-                            Move promotionMove{squareIndex, targetSquare, PAWN, capturedPiece, PROMOTION_CAPTURE};
-                            promotionMove.promotedPiece = promotionPiece;
-                            legalMoves.emplace_back(promotionMove);
-                        }
-                    }
-                    else{
-                        Move capture{squareIndex,targetSquare,BLACK_PAWN,capturedPiece,CAPTURE};
-                        legalMoves.emplace_back(capture);
-                    }
-                }                
-                std::cout << "[2] Adding capture: " << squareIndex << " to " << targetSquare << std::endl;
+                legalMoves.push_back(PackedMove(squareIndex, targetSquare));
             }
+            TRACE(TRACE_MOVES, "[1] Moving 1 tile up "<<squareIndex);
         }
 
-    }
-    else if(file==7){ //H file
-        //As white, assume tile is 48. Capture can happen on 41
-        //As black, assume tile is 8. Capture can happen on 17
-        int targetSquare = 0;
-        if (sideToMove == 'w')
-            //white to capture
-            targetSquare = squareIndex + forwardDirection * 7;  // Capture to the left
-        else
-            //black to capture
-            targetSquare = squareIndex + forwardDirection * 9;  // Capture to the right
-
-        if (targetSquare >= 0 && targetSquare <= 63) {
-            //target is still on the board
-            Piece capturedPiece = squares[targetSquare];
-            int targetRank = targetSquare/8;
-
-            // Check if the captured piece is of the opposite color
-            if (capturedPiece != EMPTY && capturedPiece * forwardDirection < 0 && targetRank!=rank) {
-                if(sideToMove=='w'){
-                    if(targetRank==7){
-                        for (Piece promotionPiece : {QUEEN, ROOK, BISHOP, KNIGHT}) {
-                            Move promotionMove{squareIndex, targetSquare, PAWN, capturedPiece, PROMOTION_CAPTURE};
-                            promotionMove.promotedPiece = promotionPiece;
-                            legalMoves.emplace_back(promotionMove);
-                        }
-                    }
-                    else{
-                        Move capture{squareIndex,targetSquare,PAWN,capturedPiece,CAPTURE};
-                        legalMoves.emplace_back(capture);
-                    }
-                }
-                else{
-                    if(targetRank==0){
-                        for (Piece promotionPiece : {BLACK_QUEEN, BLACK_ROOK, BLACK_BISHOP, BLACK_KNIGHT}) {
-                            Move promotionMove{squareIndex, targetSquare, PAWN, capturedPiece, PROMOTION_CAPTURE};
-                            promotionMove.promotedPiece = promotionPiece;
-                            legalMoves.emplace_back(promotionMove);
-                        }
-                    }
-                    else{
-                        Move capture{squareIndex,targetSquare,BLACK_PAWN,capturedPiece,CAPTURE};
-                        legalMoves.emplace_back(capture);
-                    }
-                }                
-                std::cout << "[3] Adding capture: " << squareIndex << " to " << targetSquare << std::endl;
+                                /* Move up two tiles */
+        if constexpr(Quiets){
+            int doubleSquare = targetSquare+Forward;
+            if(squareIndex/8==StartRank && squares[doubleSquare]==EMPTY && (targetMask & squareBB(doubleSquare))){
+                legalMoves.push_back(PackedMove(squareIndex, doubleSquare));
+                TRACE(TRACE_MOVES, "[2] Moving 2 tiles up "<<squareIndex);
             }
         }
     }
-    else{
-                            /* Capture a piece on the right or left side */
-        //Assume tile is 11, capture on the right is 20 as a pawn which is 2 as black
-        int targetSquare = squareIndex+forwardDirection*9;
-
-        if (targetSquare >= 0 && targetSquare <= 63) {
-            //target is still on the board
-            Piece capturedPiece = squares[targetSquare];
-            int targetRank = targetSquare/8;
 
+    if constexpr(!Captures){
+        return;
+    }
 
-            // Check if the captured piece is of the opposite color
-            if (capturedPiece != EMPTY && capturedPiece * forwardDirection < 0 && targetRank!=rank) {
-                if(sideToMove=='w'){
-                    Move capture{squareIndex,targetSquare,PAWN,capturedPiece,CAPTURE};
-                    legalMoves.emplace_back(capture);
-                }
-                else{
-                    Move capture{squareIndex,targetSquare,BLACK_PAWN,capturedPiece,CAPTURE};
-                    legalMoves.emplace_back(capture);
-                }                
-                std::cout << "[5] Adding capture: " << squareIndex << " to " << targetSquare << std::endl;
-            }
-        }
-        //Assume tile is 11, capture on the left is 18 as a pawn which is 4 as black
-        targetSquare = squareIndex+forwardDirection*7;
-        if (targetSquare >= 0 && targetSquare <= 63) {
-            //target is still on the board
-            Piece capturedPiece = squares[targetSquare];
-            int targetRank = targetSquare/8;
-
-            // Check if the captured piece is of the opposite color
-            if (capturedPiece != EMPTY && capturedPiece * forwardDirection < 0 && targetRank!=rank) {
-                if(sideToMove=='w'){
-                    if(targetRank==7){
-                        for (Piece promotionPiece : {QUEEN, ROOK, BISHOP, KNIGHT}) {
-                            Move promotionMove{squareIndex, targetSquare, PAWN, capturedPiece, PROMOTION_CAPTURE};
-                            promotionMove.promotedPiece = promotionPiece;
-                            legalMoves.emplace_back(promotionMove);
-                        }
-                    }
-                    else{
-                        Move capture{squareIndex,targetSquare,PAWN,capturedPiece,CAPTURE};
-                        legalMoves.emplace_back(capture);
-                    }
-                }
-                else{
-                    if(targetRank==0){
-                        for (Piece promotionPiece : {BLACK_QUEEN, BLACK_ROOK, BLACK_BISHOP, BLACK_KNIGHT}) {
-                            Move promotionMove{squareIndex, targetSquare, PAWN, capturedPiece, PROMOTION_CAPTURE};
-                            promotionMove.promotedPiece = promotionPiece;
-                            legalMoves.emplace_back(promotionMove);
-                        }
-                    }
-                    else{
-                        Move capture{squareIndex,targetSquare,BLACK_PAWN,capturedPiece,CAPTURE};
-                        legalMoves.emplace_back(capture);
-                    }
-                }                
-                std::cout << "[6] Adding capture: " << squareIndex << " to " << targetSquare << std::endl;
+                                /* Capture piece */
+    //The attack table already excludes captures that would wrap around the a or h file
+    Bitboard targets = pawnAttacks[Us][squareIndex] & colorBitboards[Them] & targetMask;
+    while(targets){
+        int captureSquare = popLSB(targets);
+        if(promotion){
+            for(int promotionPiece : {QUEEN, ROOK, BISHOP, KNIGHT}){
+                legalMoves.push_back(PackedMove(squareIndex, captureSquare, PackedMove::PROMOTION_FLAG, promotionPiece));
             }
         }
-    }
-    if(rank==1 || rank==6){ //This piece is a pawn on its starting square
-                            /* Move up two tiles */
-        targetSquare = squareIndex+forwardDirection*16;
-        int singleSquarePush = squareIndex+forwardDirection*8;
-        if(squares[targetSquare]==EMPTY && squares[singleSquarePush]==EMPTY){
-            //Target square 2 tiles above starting piece is empty
-            if(sideToMove=='w'){
-                Move pawn{squareIndex,targetSquare,PAWN,EMPTY,DOUBLE_PAWN_PUSH};
-                legalMoves.emplace_back(pawn);
-            }
-            else{
-                Move pawn{squareIndex,targetSquare,BLACK_PAWN,EMPTY,DOUBLE_PAWN_PUSH};
-                legalMoves.emplace_back(pawn);
-            }
-            std::cout<<"[4] Moving 2 tiles up "<<squareIndex<<std::endl;
+        else{
+            legalMoves.push_back(PackedMove(squareIndex, captureSquare));
         }
+        TRACE(TRACE_MOVES, "[Capture] Pawn moved from "<<squareIndex<<" to "<<captureSquare);
     }
 
-    //En Passant 
-    if(enPassantTargetSquare!="-"){
-        if(sideToMove=='w'){
-            // std::cout<<"EnPassant for white"<<std::endl;
-            //White can only enPassant on the 4th rank.
-            int targetSquare = algebraicToNumeric(enPassantTargetSquare);
-            int targetRank = targetSquare/8;
-            if(rank==targetRank-1){
-                Move enPassant{squareIndex,targetSquare,PAWN,BLACK_PAWN,EN_PASSANT};
-                std::cout << "[7] Adding capture enPassant: " << squareIndex << " to " << targetSquare << std::endl;
-                legalMoves.emplace_back(enPassant);
-            }
-        }
-        else if(sideToMove=='b'){
-            //Black can enPassant here
-            int targetSquare = algebraicToNumeric(enPassantTargetSquare);
-            int targetRank = targetSquare/8;
-            if(rank==targetRank+1){
-                Move enPassant{squareIndex,targetSquare,BLACK_PAWN,PAWN,EN_PASSANT};
-                std::cout << "[8B] Adding capture enPassant: " << squareIndex << " to " << targetSquare << std::endl;
-                legalMoves.emplace_back(enPassant);
-            }
-            
-        }
+                                /* En passant */
+    if(enPassantSquare >= 0 && (pawnAttacks[Us][squareIndex] & squareBB(enPassantSquare)) && isLegalEnPassant<Us>(squareIndex)){
+        legalMoves.push_back(PackedMove(squareIndex, enPassantSquare, PackedMove::EN_PASSANT_FLAG));
+        TRACE(TRACE_MOVES, "[En Passant] Pawn moved from "<<squareIndex<<" to "<<enPassantSquare);
     }
 }
 
-void Board::validBishopMove(std::vector<Move>& legalMoves, int rank, int file, int squareIndex){
-    int directions[4] = {9, 7, -9, -7};
-    //up-right, up-left, down-right, down-left
+/**
+ * En passant takes two pawns off the capturing pawn's rank at once, which
+ * can uncover a rook or queen on the king. Rather than special casing that,
+ * recompute the attacks on our king with the occupancy after the capture.
+*/
+template<Color Us>
+bool Board::isLegalEnPassant(int sourceSquare){
+    constexpr Color Them = (Us == WHITE) ? BLACK : WHITE;
+    int kingSquare = (Us == WHITE) ? whiteKingSquare : blackKingSquare;
+    int capturedSquare = enPassantSquare + ((Us == WHITE) ? -8 : 8);
+
+    Bitboard occupied = (occupiedBitboard ^ squareBB(sourceSquare) ^ squareBB(capturedSquare)) | squareBB(enPassantSquare);
+    return !(attackersTo(kingSquare, occupied) & colorBitboards[Them] & ~squareBB(capturedSquare));
+}
 
-    for(int direction:directions){
-        int currentSquare = squareIndex;
-        int targetSquare = currentSquare+direction;
+template<Color Us>
+void Board::validBishopMove(MoveList& legalMoves, int squareIndex, Bitboard targetMask){
+    //Every reachable square in one lookup, minus squares holding our own pieces
+    Bitboard targets = bishopAttacks(squareIndex, occupiedBitboard) & ~colorBitboards[Us] & targetMask;
 
-        while (isValidSquare(targetSquare) && !isEdgeFile_Bishop(currentSquare, direction)){
-            if (squares[targetSquare] == EMPTY){
-                Move normalMove{squareIndex, targetSquare, squares[squareIndex], EMPTY, NORMAL};
-                std::cout<<"Bishop moved from "<<squareIndex<<" to "<<targetSquare<<std::endl;
-                legalMoves.emplace_back(normalMove);
-            }
-            else if (isOpponentPiece(targetSquare)){
-                Piece capturedPiece = squares[targetSquare];
-                Move captureMove{squareIndex, targetSquare, squares[squareIndex], capturedPiece, CAPTURE};
-                std::cout<<"[Capture] Bishop moved from "<<squareIndex<<" to "<<targetSquare<<std::endl;
-                legalMoves.emplace_back(captureMove);
-                break;  //Cannot move further in this direction
-            }
-            else{
-                break;  //Encountered own piece
-            }
-
-            currentSquare = targetSquare;
-            targetSquare += direction;
-        }
+    while(targets){
+        int targetSquare = popLSB(targets);
+        legalMoves.push_back(PackedMove(squareIndex, targetSquare));
+        TRACE(TRACE_MOVES, "Bishop moved from "<<squareIndex<<" to "<<targetSquare);
     }
 }
 
-void Board::validKnightMove(std::vector<Move>& legalMoves, int rank, int file, int squareIndex){
-    int knightOffset[8] = {-17, -15, -10, -6, 6, 10, 15, 17};
+template<Color Us>
+void Board::validKnightMove(MoveList& legalMoves, int squareIndex, Bitboard targetMask){
+    Bitboard targets = knightAttacks[squareIndex] & ~colorBitboards[Us] & targetMask;
 
-    for (int offset:knightOffset){
-        int currentSquare = squareIndex;
-        int targetSquare = currentSquare + offset;
-
-        // Check if the target square is within the valid range of the board
-        if (isValidSquare(targetSquare) && isValidKnightTarget(currentSquare, targetSquare)){
-            //Target square is empty and we can occupy it
-            if (squares[targetSquare] == EMPTY){
-                Move normalMove{squareIndex, targetSquare, squares[squareIndex], EMPTY, NORMAL};
-                legalMoves.emplace_back(normalMove);
-                std::cout << "Moving knight from " << currentSquare << " to " << targetSquare << std::endl;
-            }
-            //Target square is occupied by opponent's piece
-            else if (isOpponentPiece(targetSquare)){
-                Piece capturedPiece = squares[targetSquare];
-                Move captureMove{squareIndex, targetSquare, squares[squareIndex], capturedPiece, CAPTURE};
-                legalMoves.emplace_back(captureMove);
-                std::cout << "[Capture] Knight moved from " << squareIndex << " to " << targetSquare << std::endl;
-            }
-        }
+    while(targets){
+        int targetSquare = popLSB(targets);
+        legalMoves.push_back(PackedMove(squareIndex, targetSquare));
+        TRACE(TRACE_MOVES, "Moving knight from " << squareIndex << " to " << targetSquare);
     }
 }
 
-void Board::validRookMove(std::vector<Move>& legalMoves, int rank, int file, int squareIndex){
-    int directions[4] = {-8,8,-1,1};
+template<Color Us>
+void Board::validRookMove(MoveList& legalMoves, int squareIndex, Bitboard targetMask){
+    Bitboard targets = rookAttacks(squareIndex, occupiedBitboard) & ~colorBitboards[Us] & targetMask;
 
-    for(int direction:directions){
-        int currentSquare = squareIndex;
-        int targetSquare = squareIndex+direction;
+    while(targets){
+        int targetSquare = popLSB(targets);
+        legalMoves.push_back(PackedMove(squareIndex, targetSquare));
+        TRACE(TRACE_MOVES, "Moving rook from "<<squareIndex<<" to "<<targetSquare);
+    }
+}
 
-        while(isValidSquare(targetSquare)){
-            //If the target square is empty, it's a valid normal move
+template<Color Us>
+void Board::validQueenMove(MoveList& legalMoves, int squareIndex, Bitboard targetMask){
+    Bitboard targets = queenAttacks(squareIndex, occupiedBitboard) & ~colorBitboards[Us] & targetMask;
 
-            if ((targetSquare / 8) != (currentSquare / 8) && (targetSquare % 8) != (currentSquare % 8)) {
-                break;  // Reached the edge of the board in the current direction, stop moving
-            }
+    while(targets){
+        int targetSquare = popLSB(targets);
+        legalMoves.push_back(PackedMove(squareIndex, targetSquare));
+        TRACE(TRACE_MOVES, "Moving Queen from "<<squareIndex<<" to "<<targetSquare);
+    }
+}
 
-            if (squares[targetSquare] == EMPTY) {
-                Move normalMove{squareIndex, targetSquare, squares[squareIndex], EMPTY, NORMAL};
-                std::cout<<"Moving rook from "<<squareIndex<<" to "<<targetSquare<<std::endl;
-                legalMoves.push_back(normalMove);
-            }
-            //If the target square is occupied by an opponent's piece, it's a valid capture move
-            else if (isOpponentPiece(targetSquare)) {
-                Piece capturedPiece = squares[targetSquare];
-                Move captureMove{squareIndex, targetSquare, squares[squareIndex], capturedPiece, CAPTURE};
-                std::cout<<"[Capture] Moving rook from "<<squareIndex<<" to "<<targetSquare<<std::endl;
-                legalMoves.push_back(captureMove);
-                // Break the loop as the rook cannot move further in this direction after a capture
-                break;
-            }
-            //If the target square is occupied by the player's own piece, stop moving in this direction
-            else {
-                break;
-            }
+/**
+ * King steps onto any square the opponent does not attack, plus castling.
+ * Target squares are tested with our king lifted off the board, otherwise
+ * the king could step backwards along the ray of a checking slider.
+*/
+template<Color Us, GenType Type>
+void Board::validKingMove(MoveList& legalMoves, int squareIndex){
+    constexpr Color Them = (Us == WHITE) ? BLACK : WHITE;
+    Bitboard withoutKing = occupiedBitboard ^ squareBB(squareIndex);
+    Bitboard targets = kingAttacks[squareIndex] & ~colorBitboards[Us];
+    if constexpr(Type == GEN_CAPTURES){
+        targets &= colorBitboards[Them];
+    }
+    else if constexpr(Type == GEN_QUIETS){
+        targets &= ~occupiedBitboard;
+    }
 
-            //Move to the next square in the current direction
-            currentSquare = targetSquare;
-            targetSquare += direction;
+    while(targets){
+        int targetSquare = popLSB(targets);
+        if(!isSquareAttacked(targetSquare, Them, withoutKing)){
+            legalMoves.push_back(PackedMove(squareIndex, targetSquare));
+            TRACE(TRACE_MOVES, "King moved from " << squareIndex << " to " << targetSquare);
         }
     }
-}
 
-void Board::validQueenMove(std::vector<Move>& legalMoves, int rank, int file, int squareIndex){
-    int queenDirections[8] = {-9, -8, -7, -1, 1, 7, 8, 9};
+    //Castling: not out of, through or into check, with nothing between king and rook
+    if constexpr(Type == GEN_CAPTURES){
+        return;
+    }
+    constexpr int HomeSquare = (Us == WHITE) ? 4 : 60;
+    constexpr uint8_t Kingside = (Us == WHITE) ? WHITE_KINGSIDE : BLACK_KINGSIDE;
+    constexpr uint8_t Queenside = (Us == WHITE) ? WHITE_QUEENSIDE : BLACK_QUEENSIDE;
+    constexpr Piece Rook = (Us == WHITE) ? ROOK : BLACK_ROOK;
+    if(squareIndex != HomeSquare || !(castlingRights & (Kingside | Queenside)) || isSquareAttacked(squareIndex, Them)){
+        return;
+    }
 
-    for (int direction : queenDirections){
-        int currentSquare = squareIndex;
-        int targetSquare = currentSquare + direction;
+    if((castlingRights & Kingside) && squares[HomeSquare + 3] == Rook
+       && !(occupiedBitboard & betweenBB[HomeSquare][HomeSquare + 3])
+       && !isSquareAttacked(HomeSquare + 1, Them) && !isSquareAttacked(HomeSquare + 2, Them)){
+        legalMoves.push_back(PackedMove(squareIndex, HomeSquare + 2, PackedMove::CASTLING_FLAG));
+        TRACE(TRACE_MOVES, "King castled kingside");
+    }
+    //The b file square only has to be empty, the king never crosses it
+    if((castlingRights & Queenside) && squares[HomeSquare - 4] == Rook
+       && !(occupiedBitboard & betweenBB[HomeSquare][HomeSquare - 4])
+       && !isSquareAttacked(HomeSquare - 1, Them) && !isSquareAttacked(HomeSquare - 2, Them)){
+        legalMoves.push_back(PackedMove(squareIndex, HomeSquare - 2, PackedMove::CASTLING_FLAG));
+        TRACE(TRACE_MOVES, "King castled queenside");
+    }
+}
 
-        int targetRank = targetSquare/8;
-        int targetFile = targetSquare%8;
+/**
+ * Pieces of both colours attacking square. Works outwards from the square:
+ * a piece attacks it exactly when the same piece standing on the square
+ * would attack the piece back, so this is a handful of table lookups.
+ * occupied may differ from the board's, for example with a piece lifted off.
+*/
+Bitboard Board::attackersTo(int square, Bitboard occupied){
+    Bitboard bishopsQueens = pieceBitboards[WHITE][BISHOP] | pieceBitboards[BLACK][BISHOP]
+                           | pieceBitboards[WHITE][QUEEN] | pieceBitboards[BLACK][QUEEN];
+    Bitboard rooksQueens = pieceBitboards[WHITE][ROOK] | pieceBitboards[BLACK][ROOK]
+                         | pieceBitboards[WHITE][QUEEN] | pieceBitboards[BLACK][QUEEN];
+
+    //Pawns are the one asymmetric case: a white pawn attacks square from where a black pawn on square would attack
+    return (pawnAttacks[BLACK][square] & pieceBitboards[WHITE][PAWN])
+         | (pawnAttacks[WHITE][square] & pieceBitboards[BLACK][PAWN])
+         | (knightAttacks[square] & (pieceBitboards[WHITE][KNIGHT] | pieceBitboards[BLACK][KNIGHT]))
+         | (kingAttacks[square] & (pieceBitboards[WHITE][KING] | pieceBitboards[BLACK][KING]))
+         | (bishopAttacks(square, occupied) & bishopsQueens)
+         | (rookAttacks(square, occupied) & rooksQueens);
+}
 
-        while (isValidSquare(targetSquare)){
-            //Check if the target square is on a different rank, file, or diagonal
-            if (std::abs(targetSquare / 8 - currentSquare / 8) > 1 || std::abs(targetSquare % 8 - currentSquare % 8) > 1) {
-                break;  //Moved too far from the current square, stop moving
-            }
+Bitboard Board::attackersTo(int square){
+    return attackersTo(square, occupiedBitboard);
+}
 
-            if (squares[targetSquare] == EMPTY){
-                Move normalMove{squareIndex, targetSquare, squares[squareIndex], EMPTY, NORMAL};
-                std::cout<<"Moving Queen from "<<squareIndex<<" to "<<targetSquare<<std::endl;
-                legalMoves.push_back(normalMove);
-            } 
-            else if (isOpponentPiece(targetSquare)){
-                Piece capturedPiece = squares[targetSquare];
-                std::cout<<"[Capture] Moving Queen from "<<squareIndex<<" to "<<targetSquare<<std::endl;
-                Move captureMove{squareIndex, targetSquare, squares[squareIndex], capturedPiece, CAPTURE};
-                legalMoves.push_back(captureMove);
-                break;
-            } 
-            else{
-                break;
-            }
+/**
+ * Whether any piece of byColor attacks square. Same idea as attackersTo but
+ * for one colour, returning at the first attacker found, cheapest tests first.
+*/
+bool Board::isSquareAttacked(int square, Color byColor, Bitboard occupied){
+    Color defender = (byColor == WHITE) ? BLACK : WHITE;
+    const Bitboard* pieces = pieceBitboards[byColor];
+
+    if(pawnAttacks[defender][square] & pieces[PAWN]) return true;
+    if(knightAttacks[square] & pieces[KNIGHT]) return true;
+    if(kingAttacks[square] & pieces[KING]) return true;
+    if(bishopAttacks(square, occupied) & (pieces[BISHOP] | pieces[QUEEN])) return true;
+    return (rookAttacks(square, occupied) & (pieces[ROOK] | pieces[QUEEN])) != 0;
+}
 
-            currentSquare = targetSquare;
-            targetSquare += direction;
+bool Board::isSquareAttacked(int square, Color byColor){
+    return isSquareAttacked(square, byColor, occupiedBitboard);
+}
+
+/**
+ * Our pieces standing alone between our king and an enemy slider on the same
+ * line. Moving one of them off that line would expose the king.
+*/
+Bitboard Board::pinnedPieces(Color color){
+    Color them = (color == WHITE) ? BLACK : WHITE;
+    int kingSquare = (color == WHITE) ? whiteKingSquare : blackKingSquare;
+
+    //Enemy sliders that would hit the king if nothing stood in between
+    Bitboard snipers = (bishopAttacks(kingSquare, 0) & (pieceBitboards[them][BISHOP] | pieceBitboards[them][QUEEN]))
+                     | (rookAttacks(kingSquare, 0) & (pieceBitboards[them][ROOK] | pieceBitboards[them][QUEEN]));
+
+    Bitboard pinned = 0;
+    while(snipers){
+        Bitboard blockers = betweenBB[kingSquare][popLSB(snipers)] & occupiedBitboard;
+        if(popCount(blockers) == 1){
+            pinned |= blockers & colorBitboards[color];
         }
     }
+    return pinned;
 }
 
-void Board::validKingMove(std::vector<Move>& legalMoves, int rank, int file, int squareIndex){
-    int kingOffsets[8] = {-9, -8, -7, -1, 1, 7, 8, 9};
+bool Board::isOpponentPiece(int squareIndex){
+    Color opponent = (colorToMove() == WHITE) ? BLACK : WHITE;
+    return (colorBitboards[opponent] & squareBB(squareIndex)) != 0;
+}
 
-    for (int offset:kingOffsets){
-        int currentSquare = squareIndex;
-        int targetSquare = currentSquare + offset;
+Color Board::colorToMove(){
+    return sideToMove;
+}
 
-        //Check if the target square is a valid square on the board
-        if (isValidSquare(targetSquare)){
-            int targetRank = targetSquare/8;
-            int targetFile = targetSquare%8;
+/**
+ * Castling rights that survive a move touching each square. Moving a king or
+ * rook off its home square, or capturing a rook on it, clears those rights.
+*/
+static const uint8_t castlingRightsKept[64] = {
+    ALL_CASTLING & ~WHITE_QUEENSIDE, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING,
+    ALL_CASTLING & ~(WHITE_KINGSIDE | WHITE_QUEENSIDE), ALL_CASTLING, ALL_CASTLING, ALL_CASTLING & ~WHITE_KINGSIDE,
+    ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING,
+    ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING,
+    ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING,
+    ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING,
+    ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING,
+    ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING,
+    ALL_CASTLING & ~BLACK_QUEENSIDE, ALL_CASTLING, ALL_CASTLING, ALL_CASTLING,
+    ALL_CASTLING & ~(BLACK_KINGSIDE | BLACK_QUEENSIDE), ALL_CASTLING, ALL_CASTLING, ALL_CASTLING & ~BLACK_KINGSIDE
+};
 
-            //Check if the target square doesn't loop from file 0 to file 7
-            if (abs(targetFile - file) <= 1){
-                // Target square is empty or occupied by opponent's piece
-                if (squares[targetSquare] == EMPTY){
-                    //Check if the target square is not adjacent to a king
-                    if (!isAdjacentToKing(targetSquare)) {
-                        Move move{squareIndex, targetSquare, squares[squareIndex], squares[targetSquare], NORMAL};
-                        legalMoves.emplace_back(move);
-                        std::cout << "King moved from " << squareIndex << " to " << targetSquare << std::endl;
-                    }
-                }
-                else{
-                    if(isOpponentPiece(targetSquare)){
-                        if (!isAdjacentToKing(targetSquare)) {
-                            Move move{squareIndex, targetSquare, squares[squareIndex], squares[targetSquare], CAPTURE};
-                            legalMoves.emplace_back(move);
-                            std::cout << "[Capture] King moved from " << squareIndex << " to " << targetSquare << std::endl;
-                        }
-                    }
-                }
-            }
-        }
+/**
+ * Plays the move on this board in place: moves the piece (and the rook when
+ * castling), removes captured pieces including en passant, promotes, and
+ * updates the FEN state for the next side to move. Whatever unmakeMove needs
+ * to restore is saved in undo.
+*/
+void Board::makeMove(PackedMove move, UndoInfo& undo){
+    int source = move.sourceSquare();
+    int target = move.targetSquare();
+    uint16_t flag = move.flag();
+
+    Piece movingPiece = squares[source];
+    bool whiteMoving = movingPiece > 0;
+    int forwardDirection = whiteMoving ? 1 : -1;
+
+    undo.capturedPiece = squares[target];
+    undo.castlingRights = castlingRights;
+    undo.enPassantSquare = enPassantSquare;
+    undo.halfMoveClock = halfMoveClock;
+    undo.whiteKingSquare = whiteKingSquare;
+    undo.blackKingSquare = blackKingSquare;
+
+    //The pawn taken en passant sits behind the target square
+    if(flag == PackedMove::EN_PASSANT_FLAG){
+        setSquare(target - forwardDirection*8, EMPTY);
+    }
+
+    //King moves two files, the rook jumps to the square it crossed
+    if(flag == PackedMove::CASTLING_FLAG){
+        int rookSource = (target > source) ? source+3 : source-4;
+        int rookTarget = (target > source) ? source+1 : source-1;
+        setSquare(rookTarget, squares[rookSource]);
+        setSquare(rookSource, EMPTY);
     }
-}
 
-bool Board::isAdjacentToKing(int squareIndex) {
-    //Define the possible offsets for adjacent squares
-    int adjacentOffsets[8] = {-9, -8, -7, -1, 1, 7, 8, 9};
+    Piece placedPiece = movingPiece;
+    if(flag == PackedMove::PROMOTION_FLAG){
+        int promotedType = move.promotedType();
+        placedPiece = Piece(whiteMoving ? promotedType : -promotedType);
+    }
+    setSquare(source, EMPTY);
+    setSquare(target, placedPiece);
 
-    //Iterate through the adjacent offsets
-    for (int offset : adjacentOffsets) {
-        int targetSquare = squareIndex + offset;
+    //setSquare already updated the key for the pieces, the rest of the state is XORed out and back in
+    zobristKey ^= zobristKeys.castling[castlingRights];
+    castlingRights &= castlingRightsKept[source] & castlingRightsKept[target];
+    zobristKey ^= zobristKeys.castling[castlingRights];
 
-        //Check if the target square is a valid square on the board
-        if (isValidSquare(targetSquare)) {
-            //Check if the target square contains a king
-            if (squares[targetSquare] == KING || squares[targetSquare] == BLACK_KING) {
-                return true; //The square is adjacent to a king
-            }
-        }
+    if(enPassantSquare >= 0){
+        zobristKey ^= zobristKeys.enPassantFile[enPassantSquare % 8];
+    }
+    bool pawnMove = typeOf(movingPiece) == PAWN;
+    enPassantSquare = (pawnMove && std::abs(target - source) == 16) ? source + forwardDirection*8 : -1;
+    if(enPassantSquare >= 0){
+        zobristKey ^= zobristKeys.enPassantFile[enPassantSquare % 8];
     }
 
-    return false; //No adjacent king found
+    if(pawnMove || undo.capturedPiece != EMPTY){
+        halfMoveClock = 0;
+    }
+    else{
+        halfMoveClock++;
+    }
+    if(!whiteMoving){
+        fullMoveNumber++;
+    }
+    sideToMove = whiteMoving ? BLACK : WHITE;
+    zobristKey ^= zobristKeys.blackToMove;
 }
 
+/**
+ * Takes back a move played with makeMove. Moves must be unmade in the
+ * reverse order they were made, each with its own undo record.
+*/
+void Board::unmakeMove(PackedMove move, const UndoInfo& undo){
+    int source = move.sourceSquare();
+    int target = move.targetSquare();
+    uint16_t flag = move.flag();
+
+    Piece placedPiece = squares[target];
+    bool whiteMoved = placedPiece > 0;
+    int forwardDirection = whiteMoved ? 1 : -1;
+
+    Piece movingPiece = placedPiece;
+    if(flag == PackedMove::PROMOTION_FLAG){
+        movingPiece = whiteMoved ? PAWN : BLACK_PAWN;
+    }
+    setSquare(target, undo.capturedPiece);
+    setSquare(source, movingPiece);
 
-bool Board::isValidSquare(int squareIndex){
-    return squareIndex >= 0 && squareIndex < 64;
-}
+    if(flag == PackedMove::EN_PASSANT_FLAG){
+        setSquare(target - forwardDirection*8, whiteMoved ? BLACK_PAWN : PAWN);
+    }
+    if(flag == PackedMove::CASTLING_FLAG){
+        int rookSource = (target > source) ? source+3 : source-4;
+        int rookTarget = (target > source) ? source+1 : source-1;
+        setSquare(rookSource, squares[rookTarget]);
+        setSquare(rookTarget, EMPTY);
+    }
 
-bool Board::isOpponentPiece(int squareIndex){
-    Piece piece = squares[squareIndex];
-    return (sideToMove == 'w' && piece < 0) || (sideToMove == 'b' && piece > 0);
+    zobristKey ^= zobristKeys.castling[castlingRights] ^ zobristKeys.castling[undo.castlingRights];
+    castlingRights = undo.castlingRights;
+    if(enPassantSquare >= 0){
+        zobristKey ^= zobristKeys.enPassantFile[enPassantSquare % 8];
+    }
+    enPassantSquare = undo.enPassantSquare;
+    if(enPassantSquare >= 0){
+        zobristKey ^= zobristKeys.enPassantFile[enPassantSquare % 8];
+    }
+    halfMoveClock = undo.halfMoveClock;
+    whiteKingSquare = undo.whiteKingSquare;
+    blackKingSquare = undo.blackKingSquare;
+    if(!whiteMoved){
+        fullMoveNumber--;
+    }
+    sideToMove = whiteMoved ? WHITE : BLACK;
+    zobristKey ^= zobristKeys.blackToMove;
 }
 
-bool Board::isEdgeFile_Bishop(int squareIndex, int direction){
-    int currentFile = squareIndex % 8;
-    int targetFile = (squareIndex + direction) % 8;
-    return (currentFile == 0 && targetFile == 7) || (currentFile == 7 && targetFile == 0);
+void Board::makeMove(const Move& move, UndoInfo& undo){
+    makeMove(PackedMove(move), undo);
 }
 
-bool Board::isValidKnightTarget(int sourceSquare, int targetSquare){
-    int sourceRank = sourceSquare/8;
-    int sourceFile = sourceSquare%8;
-    int targetRank = targetSquare/8;
-    int targetFile = targetSquare%8;
-
-    //Knight moves can only occur within a range of two ranks and one file in any direction
-    int rankDiff = std::abs(sourceRank - targetRank);
-    int fileDiff = std::abs(sourceFile - targetFile);
-
-    return rankDiff <= 2 && fileDiff <= 2 && rankDiff + fileDiff == 3;
+void Board::unmakeMove(const Move& move, const UndoInfo& undo){
+    unmakeMove(PackedMove(move), undo);
 }
 
-void Board::makeMove(Move move, Board board){
-    int source = move.sourceSquare; 
-
-    int sourceRank = source / 8;
-    int sourceFile = source % 8;
-
-    int target = move.targetSquare;
-
-    int targetRank = target / 8;
-    int targetFile = target % 8;
+/**
+ * Expands a packed move into the full Move struct, taking the moved and
+ * captured pieces from this position. Only meaningful before the move is made.
+*/
+Move Board::unpackMove(PackedMove packed){
+    int source = packed.sourceSquare();
+    int target = packed.targetSquare();
+    Piece movedPiece = squares[source];
+    Piece capturedPiece = squares[target];
+
+    MoveType type = (capturedPiece != EMPTY) ? CAPTURE : NORMAL;
+    if(packed.flag() == PackedMove::CASTLING_FLAG){
+        type = CASTLING;
+    }
+    else if(packed.flag() == PackedMove::EN_PASSANT_FLAG){
+        type = EN_PASSANT;
+        capturedPiece = (movedPiece > 0) ? BLACK_PAWN : PAWN;
+    }
+    else if(packed.flag() == PackedMove::PROMOTION_FLAG){
+        type = (capturedPiece != EMPTY) ? PROMOTION_CAPTURE : PROMOTION;
+    }
+    else if(typeOf(movedPiece) == PAWN && std::abs(target - source) == 16){
+        type = DOUBLE_PAWN_PUSH;
+    }
 
-    Piece capturedPiece = move.capturedPiece;
-    Piece promotedPiece = move.promotedPiece;
+    Move move{source, target, movedPiece, capturedPiece, type};
+    if(type == PROMOTION || type == PROMOTION_CAPTURE){
+        move.promotedPiece = Piece((movedPiece > 0) ? packed.promotedType() : -packed.promotedType());
+    }
+    return move;
+}
 
-    Piece p = board.getPiece(sourceFile,sourceRank);
+/**
+ * Convenience wrapper returning a vector. Hot paths should pass their own
+ * MoveList to the overload below and reuse it.
+*/
+std::vector<Move> Board::generateLegalMoves(char sideToMove){
+    MoveList legalMoves;
+    generateLegalMoves(sideToMove, legalMoves);
 
-    board.setPiece(targetRank,targetFile,p);
-    board.setPiece(sourceRank,sourceFile,EMPTY);
+    std::vector<Move> moves;
+    moves.reserve(legalMoves.size());
+    for(PackedMove move : legalMoves){
+        moves.push_back(unpackMove(move));
+    }
+    return moves;
 }
 
 /**
- * Interpose check by (inefficiently) looping through all legal moves and interposing checks
- * Then check if that move made will no longer place the king in check (WIP)
+ * Board:: since we are accessing a private array called squares 
+ * If squares were public we wouldn't need Board::
+ * Moves are appended to legalMoves, which the caller clears between uses.
+ *
+ * Every move generated is fully legal. Pieces other than the king may only
+ * move onto the check mask (the checker or a square blocking it, or anywhere
+ * when not in check), and pinned pieces only along their pin line. In double
+ * check only the king can move.
+ *
+ * type picks the captures (with en passant and promotions) or the quiet moves
+ * (with castling) alone, so a search can ask for quiet moves only when it
+ * gets that far. Only pieces on sourceMask are visited.
+ *
+ * Side and type are turned into template arguments here, once per call, so
+ * the generators below see them as constants and carry no colour branches.
 */
+void Board::generateLegalMoves(char sideToMove, MoveList& legalMoves, GenType type, Bitboard sourceMask){
+    generateLegalMoves((sideToMove == 'w') ? WHITE : BLACK, legalMoves, type, sourceMask);
+}
 
-std::vector<Move> Board::interposeCheck(std::vector<Move> moves, char sideToMove, Board board){
-    std::vector<Move> allMoves;
-    allMoves = moves;
-
-    std::vector<Move> legalInterpose;
+void Board::generateLegalMoves(Color side, MoveList& legalMoves, GenType type, Bitboard sourceMask){
+    if(side == WHITE){
+        switch(type){
+            case GEN_CAPTURES: generateMoves<WHITE, GEN_CAPTURES>(legalMoves, sourceMask); break;
+            case GEN_QUIETS:   generateMoves<WHITE, GEN_QUIETS>(legalMoves, sourceMask);   break;
+            case GEN_ALL:      generateMoves<WHITE, GEN_ALL>(legalMoves, sourceMask);      break;
+        }
+    }
+    else{
+        switch(type){
+            case GEN_CAPTURES: generateMoves<BLACK, GEN_CAPTURES>(legalMoves, sourceMask); break;
+            case GEN_QUIETS:   generateMoves<BLACK, GEN_QUIETS>(legalMoves, sourceMask);   break;
+            case GEN_ALL:      generateMoves<BLACK, GEN_ALL>(legalMoves, sourceMask);      break;
+        }
+    }
+}
 
-    for(Move move : allMoves){
-        Board tempBoard = board;
-        tempBoard.makeMove(move, board);
+template<Color Us, GenType Type>
+void Board::generateMoves(MoveList& legalMoves, Bitboard sourceMask){
+    constexpr Color Them = (Us == WHITE) ? BLACK : WHITE;
+    int kingSquare = (Us == WHITE) ? whiteKingSquare : blackKingSquare;
 
-        Piece p = move.movedPiece;
+    Bitboard checkers = attackersTo(kingSquare, occupiedBitboard) & colorBitboards[Them];
 
-        if(!board.isKingInCheck(sideToMove)){
-            legalInterpose.push_back(move);
-            std::cout << "\n--------------------Blocked Check--------------------\n";
-            board.printBoard();
+    if(popCount(checkers) > 1){
+        if(sourceMask & squareBB(kingSquare)){
+            validKingMove<Us, Type>(legalMoves, kingSquare);
+        }
+        return;
+    }
+    Bitboard checkMask = checkers ? (checkers | betweenBB[kingSquare][lsb(checkers)]) : ~Bitboard(0);
+    Bitboard pinned = pinnedPieces(Us);
+
+    //Pieces capture onto enemy pieces and make quiet moves onto empty squares.
+    //Pawns and the king sort out promotions and castling themselves
+    Bitboard stageMask = (Type == GEN_CAPTURES) ? colorBitboards[Them]
+                       : (Type == GEN_QUIETS) ? ~occupiedBitboard : ~colorBitboards[Us];
+
+    //Only visit squares holding a piece of the side to move, lowest square first
+    Bitboard ownPieces = colorBitboards[Us] & sourceMask;
+    while(ownPieces){
+        int squareIndex = popLSB(ownPieces);
+        Bitboard targetMask = checkMask;
+        if(pinned & squareBB(squareIndex)){
+            targetMask &= lineBB[kingSquare][squareIndex];
+        }
+        Bitboard pieceMask = targetMask & stageMask;
+        switch(typeOf(squares[squareIndex])){
+            case PAWN:
+                validPawnmove<Us, Type>(legalMoves, squareIndex, targetMask);
+                break;
+            case BISHOP:
+                validBishopMove<Us>(legalMoves, squareIndex, pieceMask);
+                break;
+            case KNIGHT:
+                validKnightMove<Us>(legalMoves, squareIndex, pieceMask);
+                break;
+            case ROOK:
+                validRookMove<Us>(legalMoves, squareIndex, pieceMask);
+                break;
+            case QUEEN:
+                validQueenMove<Us>(legalMoves, squareIndex, pieceMask);
+                break;
+            case KING:
+                validKingMove<Us, Type>(legalMoves, squareIndex);
+                break;
         }
+    }
+}
 
+/**
+ * Generates the moves of the one piece on the move's source square and looks
+ * for the move among them
+*/
+bool Board::isMoveLegal(PackedMove move){
+    if(move.isNull()){
+        return false;
+    }
+    MoveList pieceMoves;
+    generateLegalMoves(sideToMove, pieceMoves, GEN_ALL, squareBB(move.sourceSquare()));
+    for(PackedMove legalMove : pieceMoves){
+        if(legalMove == move){
+            return true;
+        }
     }
+    return false;
+}
 
-    return legalInterpose;
-    
+bool Board::isCaptureOrPromotion(PackedMove move){
+    return move.flag() == PackedMove::EN_PASSANT_FLAG || move.flag() == PackedMove::PROMOTION_FLAG
+        || (move.flag() != PackedMove::CASTLING_FLAG && squares[move.targetSquare()] != EMPTY);
 }
 
 /**
- * Board:: since we are accessing a private array called squares 
- * If squares were public we wouldn't need Board::
+ * Static exchange evaluation. Plays out the captures on the target square
+ * with both sides always recapturing with their least valuable attacker, then
+ * lets each side stop wherever carrying on would lose material. Sliders that
+ * were behind a capturing piece join in as it leaves (x-rays). Pins and
+ * checks are ignored.
 */
-std::vector<Move> Board::generateLegalMoves(char sideToMove){
-    std::vector<Move> legalMoves;
-    
-    //Loop done from 0-64 to take advantage of 1D array and parallelize
-    for(int squareIndex=0;squareIndex<64;squareIndex++){
-        Piece piece = squares[squareIndex];
-        int rank = squareIndex/8;
-        int file = squareIndex % 8;
-        if(sideToMove=='w'){            
-            switch(piece){
-                case PAWN:
-                    validPawnmove(legalMoves,rank,file,squareIndex);
-                    break;
-                case BISHOP:
-                    validBishopMove(legalMoves,rank,file,squareIndex);
-                    break;
-                case KNIGHT:
-                    validKnightMove(legalMoves,rank,file,squareIndex);
-                    break;
-                case ROOK:
-                    validRookMove(legalMoves,rank,file,squareIndex);
-                    break;
-                case QUEEN:
-                    validQueenMove(legalMoves,rank,file,squareIndex);
-                    break;
-                case KING:
-                    validKingMove(legalMoves,rank,file,squareIndex);
-                    break;
-            }         
-        }
-        else{
-            switch(piece){
-                case BLACK_PAWN:
-                    validPawnmove(legalMoves,rank,file,squareIndex);
-                    break;
-                case BLACK_BISHOP:
-                    validBishopMove(legalMoves,rank,file,squareIndex);
-                    break;
-                case BLACK_KNIGHT:
-                    validKnightMove(legalMoves,rank,file,squareIndex);
-                    break;
-                case BLACK_ROOK:
-                    validRookMove(legalMoves,rank,file,squareIndex);
-                    break;
-                case BLACK_QUEEN:
-                    validQueenMove(legalMoves,rank,file,squareIndex);
-                    break;
-                case BLACK_KING:
-                    validKingMove(legalMoves,rank,file,squareIndex);
-                    break;
-            }
-        }   
+int Board::see(PackedMove move){
+    int source = move.sourceSquare();
+    int target = move.targetSquare();
+    Color side = colorOf(squares[source]);
+    int gain[32];
+    int depth = 0;
+
+    Bitboard occupied = occupiedBitboard ^ squareBB(source);
+    int attackerValue = pieceValues[typeOf(squares[source])];
+    if(move.flag() == PackedMove::EN_PASSANT_FLAG){
+        gain[0] = pieceValues[PAWN];
+        occupied ^= squareBB(target + ((side == WHITE) ? -8 : 8));
+    }
+    else{
+        gain[0] = (squares[target] != EMPTY) ? pieceValues[typeOf(squares[target])] : 0;
+    }
+    if(move.flag() == PackedMove::PROMOTION_FLAG){
+        gain[0] += pieceValues[move.promotedType()] - pieceValues[PAWN];
+        attackerValue = pieceValues[move.promotedType()];
     }
 
-    if (sideToMove == 'b') {
-        Board::sideToMove = 'w';
-    } else if (sideToMove == 'w') {
-        Board::sideToMove = 'b';
+    Bitboard bishopsQueens = pieceBitboards[WHITE][BISHOP] | pieceBitboards[BLACK][BISHOP]
+                           | pieceBitboards[WHITE][QUEEN] | pieceBitboards[BLACK][QUEEN];
+    Bitboard rooksQueens = pieceBitboards[WHITE][ROOK] | pieceBitboards[BLACK][ROOK]
+                         | pieceBitboards[WHITE][QUEEN] | pieceBitboards[BLACK][QUEEN];
+    Bitboard attackers = attackersTo(target, occupied) & occupied;
+
+    while(depth < 31){
+        side = (side == WHITE) ? BLACK : WHITE;
+        Bitboard sideAttackers = attackers & colorBitboards[side];
+        if(!sideAttackers){
+            break;
+        }
+
+        //Least valuable attacker takes whatever captured last
+        int attackerType = PAWN;
+        while(!(sideAttackers & pieceBitboards[side][attackerType])){
+            attackerType++;
+        }
+        depth++;
+        gain[depth] = attackerValue - gain[depth - 1];
+
+        occupied ^= squareBB(lsb(sideAttackers & pieceBitboards[side][attackerType]));
+        attackers |= (bishopAttacks(target, occupied) & bishopsQueens) | (rookAttacks(target, occupied) & rooksQueens);
+        attackers &= occupied;
+        attackerValue = pieceValues[attackerType];
     }
 
-    return legalMoves;
+    //Each side chooses between recapturing and standing pat, from the end of the sequence back
+    while(depth > 0){
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+        depth--;
+    }
+    return gain[0];
 }
 
 bool Board::isColoredMove(char sideToMove, const Piece&piece){
@@ -927,7 +1403,7 @@ std::string Board::numericToAlgebraic(int squareIndex){
     }
 
     //Map the square index to algebraic notation
-    int rank = 8-(squareIndex/8);
+    int rank = squareIndex/8;
     int file = squareIndex%8;
     std::string algebraic = "";
     algebraic += ('a'+file);
@@ -936,106 +1412,32 @@ std::string Board::numericToAlgebraic(int squareIndex){
     return algebraic;
 }
 
-int Board::parseFEN(Board board){
-    std::ifstream file("testFEN.txt"); // Replace "filename.txt" with the actual name and path of your file
-    if (!file.is_open()) {
-        std::cout << "Failed to open the file." << std::endl;
-        return 1; // Exit the program if the file cannot be opened
-    }
-
-    std::string line;
-    bool proceed = true;
-    while (std::getline(file, line) && proceed) {
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back(); // Remove the carriage return character '\r' if present
-        }
-        if (!line.empty() && line.back() == '\n') {
-            line.pop_back(); // Remove the newline character '\n' if present
-        }
-        if (!line.empty() && line.find("//") == 0) {
-            std::cout << line << std::endl;
-            line.clear();
-            continue; // Skip the line
-        }
-        
-        // Process each line here
-        std::cout << line << std::endl;
-
-        // Store the line in a string variable
-        std::string storedLine = line;
-
-        board.setupPositionFromFEN(storedLine);
-        board.printBoard();
-
-        std::vector<Move> legalMoves;
-
-        auto startTime = std::chrono::steady_clock::now();
-        std::cout<<"THE SIDE TO MOVE IS "<<board.sideToMove<<"\n";
-        legalMoves = board.generateLegalMoves(board.sideToMove);
-
-        for (const auto& move : legalMoves) {
-            std::cout << move.sourceSquare<< " ";
-        }
-
-        std::cout<<"\n\nTHE SIDE TO MOVE IS "<<board.sideToMove;
-        std::cout<< "\n===================================================\n";
-
-
-        bool isChecked = board.isKingInCheck(board.sideToMove);
-        std::cout<<"HERE IS "<<board.sideToMove<<" KING CHECKED??: "<<isChecked<<std::endl;
-        // if(isChecked){
-        //     std::vector<Move> interposeCheck = board.interposeCheck(legalMoves, board.sideToMove, board);
-        // }
-
-        //wrong output. check problem
-
-        auto endTime = std::chrono::steady_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
-        
-        std::cout << "\nExecution time: " << duration << " ms\n" << std::endl;
+/**
+ * Coordinate notation used by perft divide and UCI, e.g. e2e4 or a7a8q
+*/
+std::string Board::moveToString(const Move& move){
+    return moveToString(PackedMove(move));
+}
 
-        std::cout << "\nContinue?";
-        std::cin >> proceed;
-        if(!proceed){
-            break;
-        }
-        // Clear the line variable for the next iteration
-        line.clear();
-        legalMoves.clear();
+std::string Board::moveToString(PackedMove move){
+    std::string notation = numericToAlgebraic(move.sourceSquare()) + numericToAlgebraic(move.targetSquare());
+    if(move.flag() == PackedMove::PROMOTION_FLAG){
+        notation += " pnbrqk"[move.promotedType()];
     }
-
-    file.close();
-    return 0;
+    return notation;
 }
 
 bool Board::isKingInCheck(char sideToMove){
-    std::cout<<"Checking if king is in check for "<<sideToMove<<std::endl;
+    TRACE(TRACE_DEBUG, "Checking if king is in check for "<<sideToMove);
     // Retrieve the king's square
     int kingSquare = (sideToMove == 'w') ? whiteKingSquare : blackKingSquare;
-    // Check if any opponent's piece attacks the king's square
-    std::vector<Move> opponentMoves;
+    Color opponent = (sideToMove == 'w') ? BLACK : WHITE;
 
     // Print King Position 
-    std::cout<<kingSquare<<std::endl;
+    TRACE(TRACE_DEBUG, "King square "<<kingSquare);
 
-    if(sideToMove=='w'){
-        Board::sideToMove = 'b';
-        opponentMoves=generateLegalMoves(sideToMove);
-        Board::sideToMove = 'w';
-    }
-    else{
-        Board::sideToMove = 'w';
-        opponentMoves=generateLegalMoves(sideToMove);
-        Board::sideToMove = 'b';
-    }
-        
-    // Check if any move targets the king's square
-    for (const Move& move:opponentMoves){
-        if (move.targetSquare == kingSquare){
-            return true;  //King is in check
-        }
-    }
-    return false;  //King is not in check
+    //Look outwards from the king for each kind of attacker instead of generating the opponent's moves
+    return isSquareAttacked(kingSquare, opponent);
 }
 
 void Board::updateKingSquare(int squareIndex, char side){
@@ -1045,28 +1447,3 @@ void Board::updateKingSquare(int squareIndex, char side){
         blackKingSquare = squareIndex;
     }
 }
-
-int main()
-{
-    Board board;
-    // board.setupPositionFromFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
-    // board.printBoard();
-
-    board.parseFEN(board);
-    // std::cout<<board.exportFEN()<<std::endl;
-
-    // std::vector<Move> legalMoves;
-
-    // legalMoves = board.generateLegalMoves('w');
-
-    // for (const auto& move : legalMoves) {
-    //     std::cout << move.sourceSquare<< " ";
-    // }
-    // int num = board.algebraicToNumeric("e5");
-    // std::string alg = board.numericToAlgebraic(num);
-    // std::cout<<"\n"<<num<<" "<<alg<<std::endl;
-
-    // std::cout<<"\n"<<board.getEnPassantTargetSquare()<<std::endl;
-
-    return 0;
-}
@@ -1,7 +1,15 @@
 #ifndef BOARD_H
 #define BOARD_H
 
-enum Piece {
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "bitboard.h"
+
+//One byte per square, so the mailbox is a single cache line
+enum Piece : int8_t {
     EMPTY,
     PAWN,
     KNIGHT,
@@ -17,6 +25,21 @@ enum Piece {
     BLACK_KING = -KING
     };
 
+enum Color : uint8_t {
+    WHITE,
+    BLACK
+};
+
+//Colour of a non-empty piece
+inline Color colorOf(Piece piece){
+    return piece > 0 ? WHITE : BLACK;
+}
+
+//Piece type without colour, PAWN through KING
+inline int typeOf(Piece piece){
+    return piece > 0 ? piece : -piece;
+}
+
 enum MoveType {
     NORMAL,        //Normal move
     DOUBLE_PAWN_PUSH, //Pawn moving 2 tiles upward
@@ -39,6 +62,8 @@ struct Move{
     MoveType moveType;
     Piece promotedPiece;
 
+    Move() = default;
+
     Move(int source, int target, Piece moved, Piece captured, MoveType type){
         sourceSquare = source;
         targetSquare = target;
@@ -50,18 +75,219 @@ struct Move{
 
 };
 
+/**
+ * Packed 16 bit move for move lists, hash entries and PV storage.
+ * Bits 0-5 hold the source square, bits 6-11 the target square, bits 12-13
+ * the promotion piece (knight to queen) and bits 14-15 the special kind.
+ * Moved and captured pieces are not stored; Board::unpackMove reads them
+ * from the position the move belongs to.
+*/
+struct PackedMove {
+    static constexpr uint16_t PROMOTION_FLAG = 1 << 14;
+    static constexpr uint16_t EN_PASSANT_FLAG = 2 << 14;
+    static constexpr uint16_t CASTLING_FLAG = 3 << 14;
+
+    uint16_t data = 0;  //0 (a1a1) is never a real move and marks "no move"
+
+    PackedMove() = default;
+
+    PackedMove(int source, int target, uint16_t flag = 0, int promotedType = KNIGHT){
+        data = uint16_t(source | (target << 6) | ((promotedType - KNIGHT) << 12) | flag);
+    }
+
+    explicit PackedMove(const Move& move){
+        uint16_t flag = 0;
+        int promotedType = KNIGHT;
+        switch(move.moveType){
+            case CASTLING:   flag = CASTLING_FLAG;   break;
+            case EN_PASSANT: flag = EN_PASSANT_FLAG; break;
+            case PROMOTION:
+            case PROMOTION_CAPTURE:
+                flag = PROMOTION_FLAG;
+                //The five argument constructor leaves promotedPiece EMPTY, which means a queen
+                promotedType = typeOf(move.promotedPiece);
+                if(promotedType < KNIGHT || promotedType > QUEEN){
+                    promotedType = QUEEN;
+                }
+                break;
+            default: break;
+        }
+        *this = PackedMove(move.sourceSquare, move.targetSquare, flag, promotedType);
+    }
+
+    int sourceSquare() const {
+        return data & 63;
+    }
+    int targetSquare() const {
+        return (data >> 6) & 63;
+    }
+    uint16_t flag() const {
+        return data & (3 << 14);
+    }
+    int promotedType() const {
+        return ((data >> 12) & 3) + KNIGHT;
+    }
+    bool isNull() const {
+        return data == 0;
+    }
+    bool operator==(PackedMove other) const {
+        return data == other.data;
+    }
+    bool operator!=(PackedMove other) const {
+        return data != other.data;
+    }
+};
+
+static_assert(sizeof(PackedMove) == 2, "PackedMove must stay 16 bits");
+
+/**
+ * Fixed capacity move list that lives on the caller's stack. No reachable
+ * position has more than 218 legal moves, so 256 entries always suffice and
+ * filling it never touches the heap.
+*/
+const int MAX_MOVES = 256;
+
+struct MoveList {
+    PackedMove moves[MAX_MOVES];
+    int count = 0;
+
+    void push_back(PackedMove move){
+        moves[count++] = move;
+    }
+    void push_back(const Move& move){
+        moves[count++] = PackedMove(move);
+    }
+    void clear(){
+        count = 0;
+    }
+    int size() const {
+        return count;
+    }
+    PackedMove& operator[](int index){
+        return moves[index];
+    }
+    PackedMove operator[](int index) const {
+        return moves[index];
+    }
+    PackedMove* begin(){
+        return moves;
+    }
+    PackedMove* end(){
+        return moves + count;
+    }
+    const PackedMove* begin() const {
+        return moves;
+    }
+    const PackedMove* end() const {
+        return moves + count;
+    }
+};
+
+const char* const START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+//Rough piece values in centipawns, indexed by piece type, for exchanges and pruning margins
+const int pieceValues[7] = {0, 100, 320, 330, 500, 900, 20000};
+
+//Which moves a generator call produces
+enum GenType {
+    GEN_CAPTURES,  //Captures, en passant and promotions
+    GEN_QUIETS,    //Every other move, castling included
+    GEN_ALL
+};
+
+enum CastlingRight {
+    WHITE_KINGSIDE = 1,
+    WHITE_QUEENSIDE = 2,
+    BLACK_KINGSIDE = 4,
+    BLACK_QUEENSIDE = 8,
+    ALL_CASTLING = 15
+};
+
+/**
+ * Everything makeMove overwrites that unmakeMove cannot work out from the
+ * move itself. The caller keeps one per ply, normally on its own stack frame.
+*/
+struct UndoInfo {
+    Piece capturedPiece;
+    uint8_t castlingRights;
+    int8_t enPassantSquare;
+    int16_t halfMoveClock;
+    int8_t whiteKingSquare;
+    int8_t blackKingSquare;
+};
+
+/**
+ * Why Board::parseFEN rejected its input
+*/
+enum FenError {
+    FEN_OK,
+    FEN_BAD_PLACEMENT,
+    FEN_BAD_KINGS,
+    FEN_BAD_SIDE,
+    FEN_BAD_CASTLING,
+    FEN_BAD_EN_PASSANT,
+    FEN_BAD_CLOCK,
+    FEN_TRAILING_INPUT,
+    FEN_OPPONENT_IN_CHECK
+};
+
+const char* fenErrorMessage(FenError error);
+
+/**
+ * The position part of an EPD or FEN line: the four board fields, plus the
+ * two move counters when both follow as numbers. EPD operations such as
+ * bm Qg6; id "WAC.001"; are left out.
+*/
+std::string_view epdPosition(std::string_view line);
+
+/**
+ * Fixed size binary position for large datasets, 32 bytes against 60 or so
+ * for FEN. Pieces are stored in the order of the occupied squares, lowest
+ * square first, one nibble each with the low nibble first: 0-5 white pawn to
+ * king, 6-11 black pawn to king. Fields are in host byte order.
+*/
+struct PackedPosition {
+    uint64_t occupancy;
+    uint8_t pieces[16];       //Up to 32 pieces
+    uint8_t state;            //Bit 0 black to move, bits 1-4 CastlingRight bits
+    uint8_t enPassantSquare;  //NO_EN_PASSANT when there is none
+    uint16_t halfMoveClock;
+    uint16_t fullMoveNumber;
+    uint16_t reserved;        //Always 0
+
+    static const uint8_t NO_EN_PASSANT = 64;
+};
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must stay 32 bytes");
+
+//Largest half move clock a position may carry, far past any fifty move claim
+const int MAX_HALF_MOVE_CLOCK = 10000;
+
+//Longest FEN Board::writeFEN can produce, terminator included, rounded up
+const size_t FEN_BUFFER_SIZE = 128;
+
 class Board {
     private:
+        //Bitboards mirror squares[] and are kept in sync by setPiece
+        Bitboard pieceBitboards[2][7];  //[color][piece type], type EMPTY unused
+        Bitboard colorBitboards[2];
+        Bitboard occupiedBitboard;
+        uint64_t zobristKey;
         Piece squares[64];
-        int whiteKingSquare;
-        int blackKingSquare;
 
-        //Fen information
-        char sideToMove;
-        std::string castlingAvailability;
-        std::string enPassantTargetSquare;
-        int halfMoveClock;
-        int fullMoveNumber;
+        //Fen information, as fixed size fields. The string getters below only format them
+        Color sideToMove;
+        uint8_t castlingRights;  //CastlingRight bits
+        int8_t enPassantSquare;  //-1 when there is no en passant target
+        int8_t whiteKingSquare;
+        int8_t blackKingSquare;
+        int16_t halfMoveClock;
+        uint16_t fullMoveNumber;
+
+        //Sums of pieceSquareTables over every piece, white's point of view
+        int midgameScore;
+        int endgameScore;
+        int gamePhase;
 
     public:
         Board(); 
@@ -69,16 +295,39 @@ class Board {
         //Piece methods
         Piece getPiece(int file, int rank);
         void setPiece(int rank, int file, Piece piece);
+        void setSquare(int squareIndex, Piece piece);
+        void clearBoard();
         Piece getPieceFromFENCharacter(char piece);
-        void setupPositionFromFEN(const std::string& fen);
+        //Validates fen and only then replaces the position. Allocates nothing
+        FenError parseFEN(std::string_view fen);
+        //parseFEN for callers that only need to know whether it worked
+        bool setupPositionFromFEN(std::string_view fen);
         void printBoard();
         Piece* getSquares();
-        int parseFEN(Board board);
+        Bitboard getPieces(Color color, int pieceType);
+        Bitboard getColorPieces(Color color);
+        Bitboard getOccupied();
+        uint64_t getZobristKey();
+        uint64_t computeZobristKey();
+        int getMidgameScore();
+        int getEndgameScore();
+        int getGamePhase();
+        void computeEvaluationTerms(int& midgame, int& endgame, int& phase);
 
         bool isKingInCheck(char sideToMove);
+        //Attack queries look outwards from square, no move generation involved
+        bool isSquareAttacked(int square, Color byColor);
+        bool isSquareAttacked(int square, Color byColor, Bitboard occupied);
+        Bitboard attackersTo(int square);
+        Bitboard attackersTo(int square, Bitboard occupied);
         void updateKingSquare(int squareIndex, char side);
 
+        //Binary positions. store fails above 32 pieces and load on a corrupt record
+        bool storePacked(PackedPosition& packed);
+        bool loadPacked(const PackedPosition& packed);
+
         // FEN-related functions
+        size_t writeFEN(char* buffer, size_t capacity);
         std::string exportFEN();
         std::string getSideToMove();
         std::string getCastlingAvailability();
@@ -88,27 +337,49 @@ class Board {
 
         //Move related functions
         std::vector<Move> generateLegalMoves(char sideToMove);
-        bool isMoveLegal(const Move& move);
+        void generateLegalMoves(char sideToMove, MoveList& legalMoves, GenType type = GEN_ALL, Bitboard sourceMask = ~Bitboard(0));
+        void generateLegalMoves(Color side, MoveList& legalMoves, GenType type = GEN_ALL, Bitboard sourceMask = ~Bitboard(0));
+        //For moves from elsewhere, such as the hash table, that may not belong to this position
+        bool isMoveLegal(PackedMove move);
+        //Whether the move belongs to the GEN_CAPTURES set
+        bool isCaptureOrPromotion(PackedMove move);
+        //Material the side to move expects to win from the exchange the move starts on its target square
+        int see(PackedMove move);
         //Helper function for if a piece corresponds to the right color
         bool isColoredMove(char sideToMove, const Piece&piece);
-        void validPawnmove(std::vector<Move>& legalMoves, int rank, int file, int squareIndex);
-        void validBishopMove(std::vector<Move>& legalMoves, int rank, int file, int squareIndex);
-        void validKnightMove(std::vector<Move>& legalMoves, int rank, int file, int squareIndex);
-        void validRookMove(std::vector<Move>& legalMoves, int rank, int file, int squareIndex);
-        void validQueenMove(std::vector<Move>& legalMoves, int rank, int file, int squareIndex);
-        void validKingMove(std::vector<Move>& legalMoves, int rank, int file, int squareIndex);
-        bool isAdjacentToKing(int squareIndex);
+        //The generators behind generateLegalMoves, one instance per side (and per GenType where it matters).
+        //Each only emits moves landing inside targetMask
+        template<Color Us, GenType Type> void generateMoves(MoveList& legalMoves, Bitboard sourceMask);
+        template<Color Us, GenType Type> void validPawnmove(MoveList& legalMoves, int squareIndex, Bitboard targetMask);
+        template<Color Us> bool isLegalEnPassant(int sourceSquare);
+        template<Color Us> void validBishopMove(MoveList& legalMoves, int squareIndex, Bitboard targetMask);
+        template<Color Us> void validKnightMove(MoveList& legalMoves, int squareIndex, Bitboard targetMask);
+        template<Color Us> void validRookMove(MoveList& legalMoves, int squareIndex, Bitboard targetMask);
+        template<Color Us> void validQueenMove(MoveList& legalMoves, int squareIndex, Bitboard targetMask);
+        //The king instead avoids attacked squares itself
+        template<Color Us, GenType Type> void validKingMove(MoveList& legalMoves, int squareIndex);
+        Bitboard pinnedPieces(Color color);
         int algebraicToNumeric(std::string algebraic);
         std::string numericToAlgebraic(int squareIndex);
+        std::string moveToString(const Move& move);
+        std::string moveToString(PackedMove move);
 
-        std::vector<Move> interposeCheck(std::vector<Move> moves, char sideToMove, Board board);
-        void makeMove(Move move, Board board);
+        void makeMove(PackedMove move, UndoInfo& undo);
+        void unmakeMove(PackedMove move, const UndoInfo& undo);
+        void makeMove(const Move& move, UndoInfo& undo);
+        void unmakeMove(const Move& move, const UndoInfo& undo);
+        Move unpackMove(PackedMove move);
 
-        bool isValidSquare(int squareIndex);
         bool isOpponentPiece(int squareIndex);
-        bool isEdgeFile_Bishop(int squareIndex, int direction);
-        bool isValidKnightTarget(int squareIndex, int direction);
+        Color colorToMove();
 };  
 
+/**
+ * Board holds no pointers and no heap members, so copying one (a helper
+ * thread cloning the root, copy-make) is a plain memcpy and the copy shares
+ * nothing with the original. Network state lives in the search, not here
+*/
+static_assert(std::is_trivially_copyable<Board>::value, "Board must stay trivially copyable");
+
 
 #endif  // BOARD_H
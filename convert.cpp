@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+#include "board.h"
+#include "convert.h"
+
+//Records read or written per file operation
+const size_t BATCH_POSITIONS = 4096;
+//Records loaded per timed run, few enough that their boards stay in L1
+const size_t LOAD_RUN_POSITIONS = 64;
+
+int packPositions(const std::string& inputPath, const std::string& outputPath){
+    std::ifstream input(inputPath);
+    if(!input.is_open()){
+        std::cout << "Failed to open " << inputPath << std::endl;
+        return 1;
+    }
+    std::ofstream output(outputPath, std::ios::binary);
+    if(!output.is_open()){
+        std::cout << "Failed to open " << outputPath << std::endl;
+        return 1;
+    }
+
+    std::vector<PackedPosition> batch;
+    batch.reserve(BATCH_POSITIONS);
+    Board board;
+    std::string line;
+    uint64_t packed = 0;
+    uint64_t skipped = 0;
+    auto startTime = std::chrono::steady_clock::now();
+
+    while(std::getline(input, line)){
+        std::string_view text(line);
+        while(!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')){
+            text.remove_suffix(1);
+        }
+        while(!text.empty() && (text.front() == ' ' || text.front() == '\t')){
+            text.remove_prefix(1);
+        }
+        if(text.empty() || text.compare(0, 2, "//") == 0 || text[0] == '#'){
+            continue;
+        }
+        std::string_view position = epdPosition(text);
+
+        FenError error = board.parseFEN(position);
+        PackedPosition record;
+        if(error != FEN_OK || !board.storePacked(record)){
+            std::cout << "Skipping " << (error != FEN_OK ? fenErrorMessage(error) : "position over 32 pieces") << ": " << line << std::endl;
+            skipped++;
+            continue;
+        }
+        batch.push_back(record);
+        packed++;
+        if(batch.size() == BATCH_POSITIONS){
+            output.write(reinterpret_cast<const char*>(batch.data()), batch.size() * sizeof(PackedPosition));
+            batch.clear();
+        }
+    }
+    output.write(reinterpret_cast<const char*>(batch.data()), batch.size() * sizeof(PackedPosition));
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Packed " << packed << " positions, skipped " << skipped
+              << "  time " << static_cast<uint64_t>(seconds * 1000) << " ms" << std::endl;
+    return output.good() ? 0 : 1;
+}
+
+int unpackPositions(const std::string& inputPath, const std::string& outputPath){
+    std::ifstream input(inputPath, std::ios::binary);
+    if(!input.is_open()){
+        std::cout << "Failed to open " << inputPath << std::endl;
+        return 1;
+    }
+    std::ofstream output(outputPath);
+    if(!output.is_open()){
+        std::cout << "Failed to open " << outputPath << std::endl;
+        return 1;
+    }
+
+    std::vector<PackedPosition> batch(BATCH_POSITIONS);
+    Board boards[LOAD_RUN_POSITIONS];
+    bool loaded[LOAD_RUN_POSITIONS];
+    std::string text;
+    text.reserve(BATCH_POSITIONS * 64);
+    uint64_t unpacked = 0;
+    uint64_t corrupt = 0;
+    double loadSeconds = 0;
+
+    while(input){
+        input.read(reinterpret_cast<char*>(batch.data()), batch.size() * sizeof(PackedPosition));
+        size_t count = size_t(input.gcount()) / sizeof(PackedPosition);
+
+        //Each run of records is loaded first and timed as one, so the report shows the cost
+        //of a load rather than of reading the clock or of formatting and I/O
+        for(size_t runStart = 0; runStart < count; runStart += LOAD_RUN_POSITIONS){
+            size_t runLength = std::min(LOAD_RUN_POSITIONS, count - runStart);
+            auto loadStart = std::chrono::steady_clock::now();
+            for(size_t index = 0; index < runLength; index++){
+                loaded[index] = boards[index].loadPacked(batch[runStart + index]);
+            }
+            loadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+
+            for(size_t index = 0; index < runLength; index++){
+                if(!loaded[index]){
+                    std::cout << "Corrupt record " << unpacked + corrupt << std::endl;
+                    corrupt++;
+                    continue;
+                }
+                char fen[FEN_BUFFER_SIZE];
+                text.append(fen, boards[index].writeFEN(fen, sizeof(fen)));
+                text += '\n';
+                unpacked++;
+            }
+        }
+        output.write(text.data(), text.size());
+        text.clear();
+    }
+    if(input.gcount() % sizeof(PackedPosition) != 0){
+        std::cout << "Ignoring a partial record at the end of " << inputPath << std::endl;
+        corrupt++;
+    }
+
+    std::cout << "Unpacked " << unpacked << " positions, " << corrupt << " corrupt"
+              << "  load " << static_cast<uint64_t>(unpacked > 0 ? loadSeconds * 1e9 / unpacked : 0) << " ns per position" << std::endl;
+    return corrupt == 0 && output.good() ? 0 : 1;
+}
@@ -0,0 +1,20 @@
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <string>
+
+/**
+ * Bulk conversion between text positions and PackedPosition files. A packed
+ * file is nothing but 32 byte records back to back, so position n starts at
+ * byte 32 * n.
+ *
+ * packPositions reads one FEN or EPD position per line; empty lines and
+ * lines starting with "//" or "#" are skipped, as are EPD operations.
+ * Positions that do not parse or pack are reported and left out.
+ * unpackPositions writes one FEN per record. Both return 0 on success and 1
+ * if a file could not be opened or a record was bad.
+*/
+int packPositions(const std::string& inputPath, const std::string& outputPath);
+int unpackPositions(const std::string& inputPath, const std::string& outputPath);
+
+#endif  // CONVERT_H
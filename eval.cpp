@@ -0,0 +1,160 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "board.h"
+#include "eval.h"
+#include "nnue.h"
+#include "trace.h"
+
+static constexpr int midgameValues[7] = {0, 100, 320, 330, 500, 900, 0};
+static constexpr int endgameValues[7] = {0, 120, 300, 320, 520, 920, 0};
+
+/**
+ * Piece-square bonuses for white, written as the board is printed: the first
+ * row is rank 8 and each row runs from the a file to the h file.
+*/
+static constexpr int pawnTable[64] = {
+      0,  0,  0,  0,  0,  0,  0,  0,
+     50, 50, 50, 50, 50, 50, 50, 50,
+     10, 10, 20, 30, 30, 20, 10, 10,
+      5,  5, 10, 25, 25, 10,  5,  5,
+      0,  0,  0, 20, 20,  0,  0,  0,
+      5, -5,-10,  0,  0,-10, -5,  5,
+      5, 10, 10,-20,-20, 10, 10,  5,
+      0,  0,  0,  0,  0,  0,  0,  0
+};
+
+//In the endgame only how far a pawn has advanced matters
+static constexpr int pawnEndgameTable[64] = {
+      0,  0,  0,  0,  0,  0,  0,  0,
+     80, 80, 80, 80, 80, 80, 80, 80,
+     50, 50, 50, 50, 50, 50, 50, 50,
+     30, 30, 30, 30, 30, 30, 30, 30,
+     20, 20, 20, 20, 20, 20, 20, 20,
+     10, 10, 10, 10, 10, 10, 10, 10,
+      0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0,  0
+};
+
+static constexpr int knightTable[64] = {
+    -50,-40,-30,-30,-30,-30,-40,-50,
+    -40,-20,  0,  0,  0,  0,-20,-40,
+    -30,  0, 10, 15, 15, 10,  0,-30,
+    -30,  5, 15, 20, 20, 15,  5,-30,
+    -30,  0, 15, 20, 20, 15,  0,-30,
+    -30,  5, 10, 15, 15, 10,  5,-30,
+    -40,-20,  0,  5,  5,  0,-20,-40,
+    -50,-40,-30,-30,-30,-30,-40,-50
+};
+
+static constexpr int bishopTable[64] = {
+    -20,-10,-10,-10,-10,-10,-10,-20,
+    -10,  0,  0,  0,  0,  0,  0,-10,
+    -10,  0,  5, 10, 10,  5,  0,-10,
+    -10,  5,  5, 10, 10,  5,  5,-10,
+    -10,  0, 10, 10, 10, 10,  0,-10,
+    -10, 10, 10, 10, 10, 10, 10,-10,
+    -10,  5,  0,  0,  0,  0,  5,-10,
+    -20,-10,-10,-10,-10,-10,-10,-20
+};
+
+static constexpr int rookTable[64] = {
+      0,  0,  0,  0,  0,  0,  0,  0,
+      5, 10, 10, 10, 10, 10, 10,  5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+     -5,  0,  0,  0,  0,  0,  0, -5,
+      0,  0,  0,  5,  5,  0,  0,  0
+};
+
+static constexpr int queenTable[64] = {
+    -20,-10,-10, -5, -5,-10,-10,-20,
+    -10,  0,  0,  0,  0,  0,  0,-10,
+    -10,  0,  5,  5,  5,  5,  0,-10,
+     -5,  0,  5,  5,  5,  5,  0, -5,
+      0,  0,  5,  5,  5,  5,  0, -5,
+    -10,  5,  5,  5,  5,  5,  0,-10,
+    -10,  0,  5,  0,  0,  0,  0,-10,
+    -20,-10,-10, -5, -5,-10,-10,-20
+};
+
+//The king hides behind its pawns in the midgame and heads for the centre in the endgame
+static constexpr int kingTable[64] = {
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -20,-30,-30,-40,-40,-30,-30,-20,
+    -10,-20,-20,-20,-20,-20,-20,-10,
+     20, 20,  0,  0,  0,  0, 20, 20,
+     20, 30, 10,  0,  0, 10, 30, 20
+};
+
+static constexpr int kingEndgameTable[64] = {
+    -50,-40,-30,-20,-20,-30,-40,-50,
+    -30,-20,-10,  0,  0,-10,-20,-30,
+    -30,-10, 20, 30, 30, 20,-10,-30,
+    -30,-10, 30, 40, 40, 30,-10,-30,
+    -30,-10, 30, 40, 40, 30,-10,-30,
+    -30,-10, 20, 30, 30, 20,-10,-30,
+    -30,-30,  0,  0,  0,  0,-30,-30,
+    -50,-30,-30,-30,-30,-30,-30,-50
+};
+
+static constexpr PieceSquareTables generateTables(){
+    const int* midgameTables[7] = {nullptr, pawnTable, knightTable, bishopTable, rookTable, queenTable, kingTable};
+    const int* endgameTables[7] = {nullptr, pawnEndgameTable, knightTable, bishopTable, rookTable, queenTable, kingEndgameTable};
+    PieceSquareTables tables{};
+
+    for(int pieceType = PAWN; pieceType <= KING; pieceType++){
+        for(int squareIndex = 0; squareIndex < 64; squareIndex++){
+            //The tables start at rank 8, so white flips the rank and black, seeing the board mirrored, does not
+            int whiteIndex = squareIndex ^ 56;
+            tables.midgame[WHITE][pieceType][squareIndex] = int16_t(midgameValues[pieceType] + midgameTables[pieceType][whiteIndex]);
+            tables.endgame[WHITE][pieceType][squareIndex] = int16_t(endgameValues[pieceType] + endgameTables[pieceType][whiteIndex]);
+            tables.midgame[BLACK][pieceType][squareIndex] = int16_t(-midgameValues[pieceType] - midgameTables[pieceType][squareIndex]);
+            tables.endgame[BLACK][pieceType][squareIndex] = int16_t(-endgameValues[pieceType] - endgameTables[pieceType][squareIndex]);
+        }
+    }
+    return tables;
+}
+
+constexpr PieceSquareTables pieceSquareTables = generateTables();
+
+/**
+ * The network when an accumulator for this position is given. Otherwise blends
+ * the midgame and endgame sums by how much material is left, so the score
+ * slides smoothly from one to the other as pieces come off.
+*/
+int evaluate(Board& board, const Accumulator* accumulator){
+    if(accumulator){
+        if constexpr(ALPHAOMEGA_DEBUG_EVAL){
+            Accumulator refreshed;
+            refreshAccumulator(refreshed, board);
+            if(std::memcmp(&refreshed, accumulator, sizeof(Accumulator)) != 0){
+                std::cerr << "Network accumulator out of sync in " << board.exportFEN() << std::endl;
+                traceDump(std::cerr);
+                std::abort();
+            }
+        }
+        return evaluateNetwork(*accumulator, board.colorToMove());
+    }
+
+    if constexpr(ALPHAOMEGA_DEBUG_EVAL){
+        int midgame, endgame, phase;
+        board.computeEvaluationTerms(midgame, endgame, phase);
+        if(midgame != board.getMidgameScore() || endgame != board.getEndgameScore() || phase != board.getGamePhase()){
+            std::cerr << "Incremental evaluation out of sync in " << board.exportFEN() << std::endl;
+            traceDump(std::cerr);
+            std::abort();
+        }
+    }
+
+    //Promotions can push the phase past the start position's
+    int phase = board.getGamePhase() < TOTAL_PHASE ? board.getGamePhase() : TOTAL_PHASE;
+    int score = (board.getMidgameScore() * phase + board.getEndgameScore() * (TOTAL_PHASE - phase)) / TOTAL_PHASE;
+    return board.colorToMove() == WHITE ? score : -score;
+}
@@ -0,0 +1,38 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include <cstdint>
+
+class Board;
+struct Accumulator;
+
+/**
+ * Material plus piece-square values for every piece on every square, in
+ * separate midgame and endgame tables. Values are from white's point of
+ * view, so black pieces hold negative numbers and a position's score is the
+ * plain sum over its pieces. Board keeps those sums up to date in setSquare.
+*/
+struct PieceSquareTables {
+    int16_t midgame[2][7][64];  //[color][piece type][square]
+    int16_t endgame[2][7][64];
+};
+
+//Generated at compile time, so usable before main() runs
+extern const PieceSquareTables pieceSquareTables;
+
+//How much each piece type counts towards the midgame. The start position has TOTAL_PHASE
+const int phaseWeights[7] = {0, 0, 1, 1, 2, 4, 0};
+const int TOTAL_PHASE = 24;
+
+/**
+ * Build with -DALPHAOMEGA_DEBUG_EVAL=1 to check the incremental sums against
+ * a full recomputation on every evaluate call.
+*/
+#ifndef ALPHAOMEGA_DEBUG_EVAL
+#define ALPHAOMEGA_DEBUG_EVAL 0
+#endif
+
+//Score in centipawns from the side to move's point of view. accumulator, when given, must match board
+int evaluate(Board& board, const Accumulator* accumulator = nullptr);
+
+#endif  // EVAL_H
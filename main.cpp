@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "analyze.h"
+#include "bitboard.h"
+#include "convert.h"
+#include "nnue.h"
+#include "perft.h"
+#include "search.h"
+#include "tt.h"
+#include "uci.h"
+
+static void printUsage(){
+    std::cout << "Usage:\n"
+              << "  alphaomega                    (UCI mode, reads commands from standard input)\n"
+              << "  alphaomega perft <depth> [file.epd]\n"
+              << "  alphaomega divide <depth> [file.epd]\n"
+              << "  alphaomega search [depth <n>] [nodes <n>] [movetime <ms>] [hash <MB>] [threads <n>] [evalfile <path>] [fen <fen>]\n"
+              << "  alphaomega smp <depth> <max threads> [fen <fen>]\n"
+              << "  alphaomega pack <input.epd> <output.bin>\n"
+              << "  alphaomega unpack <input.bin> <output.epd>\n"
+              << "  alphaomega analyze <input.epd> <output> [depth <n>] [nodes <n>] [threads <n>] [hash <MB per thread>] [evalfile <path>]\n"
+              << "The EPD file defaults to perft.epd, the search position to the start position" << std::endl;
+}
+
+/**
+ * Searches one position with the limits given as "name value" pairs and
+ * prints the best move. Everything after "fen" is taken as the position.
+*/
+static int runSearch(int argc, char* argv[]){
+    SearchLimits limits;
+    int threads = 1;
+    std::string fen = START_FEN;
+
+    for(int arg = 2; arg + 1 < argc; arg += 2){
+        std::string name = argv[arg];
+        if(name == "fen"){
+            fen = argv[arg + 1];
+            for(int field = arg + 2; field < argc; field++){
+                fen += std::string(" ") + argv[field];
+            }
+            break;
+        }
+        if(name == "evalfile"){
+            if(!loadNetwork(argv[arg + 1])){
+                std::cerr << "Could not load network " << argv[arg + 1] << std::endl;
+                return 1;
+            }
+            continue;
+        }
+        long long value = std::atoll(argv[arg + 1]);
+        if(name == "depth") limits.depth = int(value);
+        else if(name == "nodes") limits.nodes = uint64_t(value);
+        else if(name == "movetime") limits.moveTime = value;
+        else if(name == "hash") transpositionTable.resize(size_t(value));
+        else if(name == "threads") threads = std::max(1, int(value));
+        else{
+            printUsage();
+            return 1;
+        }
+    }
+
+    Board board;
+    FenError error = board.parseFEN(fen);
+    if(error != FEN_OK){
+        std::cerr << "Invalid FEN (" << fenErrorMessage(error) << "): " << fen << std::endl;
+        return 1;
+    }
+
+    Search search(board, limits, {}, threads);
+    PackedMove bestMove = search.think();
+    std::cout << "bestmove " << board.moveToString(bestMove) << std::endl;
+    return 0;
+}
+
+/**
+ * Batch analysis of a position file, fixed depth 6 unless depth or nodes
+ * is given. threads is the number of positions searched at once.
+*/
+static int runAnalyze(int argc, char* argv[]){
+    if(argc < 4){
+        printUsage();
+        return 1;
+    }
+    SearchLimits limits;
+    limits.depth = 6;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t hashMegabytes = DEFAULT_ANALYSIS_HASH;
+
+    for(int arg = 4; arg + 1 < argc; arg += 2){
+        std::string name = argv[arg];
+        if(name == "evalfile"){
+            if(!loadNetwork(argv[arg + 1])){
+                std::cerr << "Could not load network " << argv[arg + 1] << std::endl;
+                return 1;
+            }
+            continue;
+        }
+        long long value = std::atoll(argv[arg + 1]);
+        if(name == "depth") limits.depth = std::max(1, std::min(int(value), MAX_PLY - 1));
+        else if(name == "nodes"){
+            limits.nodes = uint64_t(value);
+            limits.depth = MAX_PLY - 1;
+        }
+        else if(name == "hash") hashMegabytes = size_t(std::max(1LL, value));
+        else if(name == "threads") threads = std::max(1, int(value));
+        else{
+            printUsage();
+            return 1;
+        }
+    }
+    return runBatchAnalysis(argv[2], argv[3], limits, threads, hashMegabytes);
+}
+
+/**
+ * Searches the same position to a fixed depth with 1, 2, 4... threads up to
+ * maxThreads, starting from an empty hash table each time, and prints how
+ * time-to-depth and nodes/second scale against one thread.
+*/
+static int runSmpScaling(int argc, char* argv[]){
+    if(argc < 4){
+        printUsage();
+        return 1;
+    }
+    SearchLimits limits;
+    limits.depth = std::atoi(argv[2]);
+    int maxThreads = std::max(1, std::atoi(argv[3]));
+
+    std::string fen = START_FEN;
+    if(argc > 5 && std::string(argv[4]) == "fen"){
+        fen = argv[5];
+        for(int field = 6; field < argc; field++){
+            fen += std::string(" ") + argv[field];
+        }
+    }
+
+    Board board;
+    FenError error = board.parseFEN(fen);
+    if(error != FEN_OK){
+        std::cerr << "Invalid FEN (" << fenErrorMessage(error) << "): " << fen << std::endl;
+        return 1;
+    }
+
+    double baseSeconds = 0;
+    double baseNps = 0;
+    for(int threads = 1; threads <= maxThreads; threads *= 2){
+        transpositionTable.clear();
+        Search search(board, limits, {}, threads);
+
+        auto startTime = std::chrono::steady_clock::now();
+        search.think();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        double nps = seconds > 0 ? search.getNodes() / seconds : 0;
+        if(threads == 1){
+            baseSeconds = seconds;
+            baseNps = nps;
+        }
+
+        std::cout << "threads " << threads
+                  << "  time " << static_cast<uint64_t>(seconds * 1000) << " ms"
+                  << "  nodes " << search.getNodes()
+                  << "  nps " << static_cast<uint64_t>(nps)
+                  << "  time-to-depth speedup " << (seconds > 0 ? baseSeconds / seconds : 0)
+                  << "  nps speedup " << (baseNps > 0 ? nps / baseNps : 0) << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    initBitboards();
+    initNnue();
+
+    if(argc < 2 || std::string(argv[1]) == "uci"){
+        return runUci(std::cin);
+    }
+    if(std::string(argv[1]) == "search"){
+        return runSearch(argc, argv);
+    }
+    if(std::string(argv[1]) == "pack" || std::string(argv[1]) == "unpack"){
+        if(argc < 4){
+            printUsage();
+            return 1;
+        }
+        return std::string(argv[1]) == "pack" ? packPositions(argv[2], argv[3]) : unpackPositions(argv[2], argv[3]);
+    }
+    if(std::string(argv[1]) == "analyze"){
+        return runAnalyze(argc, argv);
+    }
+    if(std::string(argv[1]) == "smp"){
+        return runSmpScaling(argc, argv);
+    }
+    if(argc < 3){
+        printUsage();
+        return 1;
+    }
+
+    std::string mode = argv[1];
+    int depth = std::atoi(argv[2]);
+    std::string epdPath = (argc > 3) ? argv[3] : "perft.epd";
+
+    if(mode == "perft"){
+        return runPerftSuite(epdPath, depth, false);
+    }
+    if(mode == "divide"){
+        return runPerftSuite(epdPath, depth, true);
+    }
+
+    printUsage();
+    return 1;
+}
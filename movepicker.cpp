@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "movepicker.h"
+
+//Counter-moves sort ahead of any history score
+const int COUNTER_MOVE_BONUS = 1 << 20;
+
+void MoveHistory::clear(){
+    std::memset(history, 0, sizeof(history));
+    for(auto& colorMoves : counterMoves){
+        for(auto& pieceMoves : colorMoves){
+            for(PackedMove& move : pieceMoves){
+                move = PackedMove();
+            }
+        }
+    }
+}
+
+/**
+ * History gravity: each update moves the entry towards +-MAX_HISTORY by a
+ * share of the remaining distance, so entries saturate instead of
+ * overflowing and old results fade as new ones come in
+*/
+static void applyBonus(int16_t& entry, int bonus){
+    entry += bonus - entry * std::abs(bonus) / MoveHistory::MAX_HISTORY;
+}
+
+void MoveHistory::update(Color side, PackedMove bestMove, const PackedMove* triedQuiets, int triedCount, int depth){
+    int bonus = std::min(depth * depth, 1200);
+    applyBonus(history[side][bestMove.sourceSquare()][bestMove.targetSquare()], bonus);
+    for(int index = 0; index < triedCount; index++){
+        if(triedQuiets[index] != bestMove){
+            applyBonus(history[side][triedQuiets[index].sourceSquare()][triedQuiets[index].targetSquare()], -bonus);
+        }
+    }
+}
+
+MovePicker::MovePicker(Board& board, PackedMove ttMove, const PackedMove* killers, const MoveHistory* history, PackedMove counterMove)
+    : board(board), capturesOnly(false), stage(TT_MOVE), ttMove(ttMove), killerIndex(0),
+      history(history), counterMove(counterMove), moveIndex(0), badCaptureIndex(0){
+    side = board.colorToMove() == WHITE ? 'w' : 'b';
+    this->killers[0] = killers ? killers[0] : PackedMove();
+    this->killers[1] = killers ? killers[1] : PackedMove();
+}
+
+MovePicker::MovePicker(Board& board, PackedMove ttMove)
+    : MovePicker(board, ttMove, nullptr){
+    capturesOnly = true;
+}
+
+bool MovePicker::alreadyTried(PackedMove move) const {
+    return move == ttMove || move == killers[0] || move == killers[1];
+}
+
+/**
+ * Most valuable victim first, and among equal victims the least valuable
+ * attacker. Promotions count the piece gained.
+*/
+void MovePicker::scoreCaptures(){
+    Piece* squares = board.getSquares();
+    for(int index = 0; index < moves.size(); index++){
+        PackedMove move = moves[index];
+        int victim = (move.flag() == PackedMove::EN_PASSANT_FLAG) ? PAWN : typeOf(squares[move.targetSquare()]);
+        int score = pieceValues[victim] * 8 - typeOf(squares[move.sourceSquare()]);
+        if(move.flag() == PackedMove::PROMOTION_FLAG){
+            score += pieceValues[move.promotedType()] * 8;
+        }
+        scores[index] = score;
+    }
+}
+
+void MovePicker::scoreQuiets(){
+    Color us = board.colorToMove();
+    for(int index = 0; index < moves.size(); index++){
+        PackedMove move = moves[index];
+        scores[index] = history ? history->get(us, move) : 0;
+        if(move == counterMove){
+            scores[index] += COUNTER_MOVE_BONUS;
+        }
+    }
+}
+
+PackedMove MovePicker::pickBest(){
+    int best = moveIndex;
+    for(int index = moveIndex + 1; index < moves.size(); index++){
+        if(scores[index] > scores[best]){
+            best = index;
+        }
+    }
+    std::swap(moves[moveIndex], moves[best]);
+    std::swap(scores[moveIndex], scores[best]);
+    return moves[moveIndex++];
+}
+
+PackedMove MovePicker::nextMove(){
+    switch(stage){
+        case TT_MOVE:
+            stage = GENERATE_CAPTURES;
+            //The hash move may come from a different position that shares the key
+            if(!board.isMoveLegal(ttMove) || (capturesOnly && !board.isCaptureOrPromotion(ttMove))){
+                ttMove = PackedMove();
+            }
+            else{
+                return ttMove;
+            }
+            [[fallthrough]];
+
+        case GENERATE_CAPTURES:
+            moves.clear();
+            moveIndex = 0;
+            board.generateLegalMoves(side, moves, GEN_CAPTURES);
+            scoreCaptures();
+            stage = CAPTURES;
+            [[fallthrough]];
+
+        case CAPTURES:
+            while(moveIndex < moves.size()){
+                PackedMove move = pickBest();
+                if(move == ttMove){
+                    continue;
+                }
+                //Quiescence prunes losing captures itself, so only the main search defers them
+                if(!capturesOnly && board.see(move) < 0){
+                    badCaptures.push_back(move);
+                    continue;
+                }
+                return move;
+            }
+            if(capturesOnly){
+                stage = DONE;
+                return PackedMove();
+            }
+            stage = KILLERS;
+            [[fallthrough]];
+
+        case KILLERS:
+            //Killers are quiet moves that refuted a sibling node and only need to be legal here
+            while(killerIndex < 2){
+                PackedMove killer = killers[killerIndex++];
+                if(killer != ttMove && (killerIndex == 1 || killer != killers[0])
+                   && board.isMoveLegal(killer) && !board.isCaptureOrPromotion(killer)){
+                    return killer;
+                }
+            }
+            stage = GENERATE_QUIETS;
+            [[fallthrough]];
+
+        case GENERATE_QUIETS:
+            moves.clear();
+            moveIndex = 0;
+            board.generateLegalMoves(side, moves, GEN_QUIETS);
+            scoreQuiets();
+            stage = QUIETS;
+            [[fallthrough]];
+
+        case QUIETS:
+            while(moveIndex < moves.size()){
+                PackedMove move = pickBest();
+                if(!alreadyTried(move)){
+                    return move;
+                }
+            }
+            stage = BAD_CAPTURES;
+            [[fallthrough]];
+
+        case BAD_CAPTURES:
+            if(badCaptureIndex < badCaptures.size()){
+                return badCaptures[badCaptureIndex++];
+            }
+            stage = DONE;
+            [[fallthrough]];
+
+        case DONE:
+            break;
+    }
+    return PackedMove();
+}
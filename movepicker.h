@@ -0,0 +1,93 @@
+#ifndef MOVEPICKER_H
+#define MOVEPICKER_H
+
+#include <cstdint>
+
+#include "board.h"
+
+/**
+ * Quiet move statistics one search thread gathers for ordering. Each thread
+ * owns its own, so they are read and written without synchronisation.
+*/
+struct MoveHistory {
+    //History scores stay within +-MAX_HISTORY
+    static const int MAX_HISTORY = 16384;
+
+    //Butterfly table, [color][source][target]: how often the move caused a cutoff, decayed over time
+    int16_t history[2][64][64];
+    //The reply that last refuted a move, [color][piece type][target] of the move being answered
+    PackedMove counterMoves[2][7][64];
+
+    void clear();
+    //Rewards the quiet move that cut off and penalises the quiet moves tried before it
+    void update(Color side, PackedMove bestMove, const PackedMove* triedQuiets, int triedCount, int depth);
+    int get(Color side, PackedMove move) const {
+        return history[side][move.sourceSquare()][move.targetSquare()];
+    }
+};
+
+/**
+ * Hands out the legal moves of a position one at a time, generating them in
+ * stages: the hash move, then captures and promotions, then the killer moves,
+ * then the remaining quiet moves, and last the captures that lose material by
+ * static exchange evaluation. Each stage is only generated when the one
+ * before it runs out, so a node that cuts off early never generates its quiet
+ * moves at all.
+ *
+ * Within a stage the best scored move comes first. Captures are scored most
+ * valuable victim, least valuable attacker; quiet moves by history, with the
+ * counter-move to the previous move ahead of the rest.
+ *
+ * The board must stay in the same position between calls to nextMove, apart
+ * from moves made and unmade again by the caller.
+*/
+class MovePicker {
+    public:
+        //Main search: every legal move. killers and history may be null
+        MovePicker(Board& board, PackedMove ttMove, const PackedMove* killers,
+                   const MoveHistory* history = nullptr, PackedMove counterMove = PackedMove());
+        //Quiescence: captures and promotions only
+        MovePicker(Board& board, PackedMove ttMove);
+
+        //Returns a null move once every stage is exhausted
+        PackedMove nextMove();
+
+    private:
+        enum Stage {
+            TT_MOVE,
+            GENERATE_CAPTURES,
+            CAPTURES,
+            KILLERS,
+            GENERATE_QUIETS,
+            QUIETS,
+            BAD_CAPTURES,
+            DONE
+        };
+
+        //Moves already handed out by an earlier stage
+        bool alreadyTried(PackedMove move) const;
+        void scoreCaptures();
+        void scoreQuiets();
+        //Swaps the highest scored remaining move to moveIndex and returns it
+        PackedMove pickBest();
+
+        Board& board;
+        char side;
+        bool capturesOnly;
+        Stage stage;
+
+        PackedMove ttMove;
+        PackedMove killers[2];
+        int killerIndex;
+        const MoveHistory* history;
+        PackedMove counterMove;
+
+        MoveList moves;
+        int scores[MAX_MOVES];
+        int moveIndex;
+        //Losing captures held back until after the quiet moves
+        MoveList badCaptures;
+        int badCaptureIndex;
+};
+
+#endif  // MOVEPICKER_H
@@ -0,0 +1,297 @@
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "nnue.h"
+#include "tt.h"
+
+/**
+ * The loaded network. Every pointer points into the read-only file mapping,
+ * so loading costs no copying and several processes share the same pages.
+*/
+struct Network {
+    const int16_t* featureWeights = nullptr;
+    const int16_t* featureBiases = nullptr;
+    const int16_t* outputWeights = nullptr;
+    int32_t outputBias = 0;
+
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+};
+
+static Network network;
+
+static const char NETWORK_MAGIC[4] = {'A', 'O', 'N', 'N'};
+static const uint32_t NETWORK_VERSION = 1;
+static const size_t HEADER_SIZE = 12;
+
+typedef void (*ColumnKernel)(int16_t* values, const int16_t* column);
+typedef int32_t (*OutputKernel)(const int16_t* us, const int16_t* them, const int16_t* weights);
+
+static void addColumnScalar(int16_t* values, const int16_t* column){
+    for(int index = 0; index < NNUE_HIDDEN; index++){
+        values[index] = int16_t(values[index] + column[index]);
+    }
+}
+
+static void subtractColumnScalar(int16_t* values, const int16_t* column){
+    for(int index = 0; index < NNUE_HIDDEN; index++){
+        values[index] = int16_t(values[index] - column[index]);
+    }
+}
+
+static int32_t outputScalar(const int16_t* us, const int16_t* them, const int16_t* weights){
+    int32_t sum = 0;
+    for(int index = 0; index < NNUE_HIDDEN; index++){
+        int clippedUs = us[index] < 0 ? 0 : (us[index] > NNUE_CLIP ? NNUE_CLIP : us[index]);
+        int clippedThem = them[index] < 0 ? 0 : (them[index] > NNUE_CLIP ? NNUE_CLIP : them[index]);
+        sum += clippedUs * weights[index] + clippedThem * weights[NNUE_HIDDEN + index];
+    }
+    return sum;
+}
+
+#if defined(__x86_64__)
+//Accumulators are 64 byte aligned; weight columns in the mapping are only 2 byte aligned, hence loadu
+__attribute__((target("avx2")))
+static void addColumnAvx2(int16_t* values, const int16_t* column){
+    for(int index = 0; index < NNUE_HIDDEN; index += 16){
+        __m256i sum = _mm256_add_epi16(_mm256_load_si256((const __m256i*)(values + index)),
+                                       _mm256_loadu_si256((const __m256i*)(column + index)));
+        _mm256_store_si256((__m256i*)(values + index), sum);
+    }
+}
+
+__attribute__((target("avx2")))
+static void subtractColumnAvx2(int16_t* values, const int16_t* column){
+    for(int index = 0; index < NNUE_HIDDEN; index += 16){
+        __m256i difference = _mm256_sub_epi16(_mm256_load_si256((const __m256i*)(values + index)),
+                                              _mm256_loadu_si256((const __m256i*)(column + index)));
+        _mm256_store_si256((__m256i*)(values + index), difference);
+    }
+}
+
+__attribute__((target("avx2")))
+static int32_t outputAvx2(const int16_t* us, const int16_t* them, const int16_t* weights){
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i clip = _mm256_set1_epi16(NNUE_CLIP);
+    __m256i sum = zero;
+    const int16_t* halves[2] = {us, them};
+
+    for(int half = 0; half < 2; half++){
+        for(int index = 0; index < NNUE_HIDDEN; index += 16){
+            __m256i clipped = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i*)(halves[half] + index)), zero), clip);
+            __m256i weight = _mm256_loadu_si256((const __m256i*)(weights + half * NNUE_HIDDEN + index));
+            //Pairs of 16 bit products summed into 32 bit lanes
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(clipped, weight));
+        }
+    }
+
+    __m128i lanes = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    lanes = _mm_add_epi32(lanes, _mm_shuffle_epi32(lanes, 0x4E));
+    lanes = _mm_add_epi32(lanes, _mm_shuffle_epi32(lanes, 0xB1));
+    return _mm_cvtsi128_si32(lanes);
+}
+
+__attribute__((target("sse4.1")))
+static void addColumnSse41(int16_t* values, const int16_t* column){
+    for(int index = 0; index < NNUE_HIDDEN; index += 8){
+        __m128i sum = _mm_add_epi16(_mm_load_si128((const __m128i*)(values + index)),
+                                    _mm_loadu_si128((const __m128i*)(column + index)));
+        _mm_store_si128((__m128i*)(values + index), sum);
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void subtractColumnSse41(int16_t* values, const int16_t* column){
+    for(int index = 0; index < NNUE_HIDDEN; index += 8){
+        __m128i difference = _mm_sub_epi16(_mm_load_si128((const __m128i*)(values + index)),
+                                           _mm_loadu_si128((const __m128i*)(column + index)));
+        _mm_store_si128((__m128i*)(values + index), difference);
+    }
+}
+
+__attribute__((target("sse4.1")))
+static int32_t outputSse41(const int16_t* us, const int16_t* them, const int16_t* weights){
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i clip = _mm_set1_epi16(NNUE_CLIP);
+    __m128i sum = zero;
+    const int16_t* halves[2] = {us, them};
+
+    for(int half = 0; half < 2; half++){
+        for(int index = 0; index < NNUE_HIDDEN; index += 8){
+            __m128i clipped = _mm_min_epi16(_mm_max_epi16(_mm_load_si128((const __m128i*)(halves[half] + index)), zero), clip);
+            __m128i weight = _mm_loadu_si128((const __m128i*)(weights + half * NNUE_HIDDEN + index));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(clipped, weight));
+        }
+    }
+
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+static ColumnKernel addColumn = addColumnScalar;
+static ColumnKernel subtractColumn = subtractColumnScalar;
+static OutputKernel outputLayer = outputScalar;
+static const char* kernelName = "scalar";
+
+void initNnue(){
+#if defined(__x86_64__)
+    //ALPHAOMEGA_NO_SIMD keeps the scalar kernels, for checking the vector ones against them
+    if(std::getenv("ALPHAOMEGA_NO_SIMD") != nullptr){
+        return;
+    }
+    if(__builtin_cpu_supports("avx2")){
+        addColumn = addColumnAvx2;
+        subtractColumn = subtractColumnAvx2;
+        outputLayer = outputAvx2;
+        kernelName = "avx2";
+    }
+    else if(__builtin_cpu_supports("sse4.1")){
+        addColumn = addColumnSse41;
+        subtractColumn = subtractColumnSse41;
+        outputLayer = outputSse41;
+        kernelName = "sse4.1";
+    }
+#endif
+}
+
+const char* nnueKernelName(){
+    return kernelName;
+}
+
+static void unloadNetwork(){
+    if(network.mapping != nullptr){
+        munmap(network.mapping, network.mappingSize);
+    }
+    network = Network();
+}
+
+/**
+ * The new file is mapped and checked on its own, so a bad path leaves the
+ * current network in place.
+*/
+bool loadNetwork(const std::string& path){
+    int file = open(path.c_str(), O_RDONLY);
+    if(file < 0){
+        return false;
+    }
+    struct stat status;
+    size_t expectedSize = HEADER_SIZE
+                        + sizeof(int16_t) * (size_t(NNUE_INPUTS) * NNUE_HIDDEN + NNUE_HIDDEN + 2 * NNUE_HIDDEN)
+                        + sizeof(int32_t);
+    if(fstat(file, &status) != 0 || size_t(status.st_size) != expectedSize){
+        close(file);
+        return false;
+    }
+    void* mapping = mmap(nullptr, expectedSize, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);  //The mapping stays valid without the descriptor
+    if(mapping == MAP_FAILED){
+        return false;
+    }
+
+    const char* bytes = static_cast<const char*>(mapping);
+    uint32_t version;
+    uint32_t hiddenSize;
+    std::memcpy(&version, bytes + 4, sizeof(version));
+    std::memcpy(&hiddenSize, bytes + 8, sizeof(hiddenSize));
+    if(std::memcmp(bytes, NETWORK_MAGIC, 4) != 0 || version != NETWORK_VERSION || hiddenSize != uint32_t(NNUE_HIDDEN)){
+        munmap(mapping, expectedSize);
+        return false;
+    }
+
+    Network loaded;
+    loaded.mapping = mapping;
+    loaded.mappingSize = expectedSize;
+    loaded.featureWeights = reinterpret_cast<const int16_t*>(bytes + HEADER_SIZE);
+    loaded.featureBiases = loaded.featureWeights + size_t(NNUE_INPUTS) * NNUE_HIDDEN;
+    loaded.outputWeights = loaded.featureBiases + NNUE_HIDDEN;
+    std::memcpy(&loaded.outputBias, loaded.outputWeights + 2 * NNUE_HIDDEN, sizeof(int32_t));
+
+    unloadNetwork();
+    network = loaded;
+    //Stored scores came from the old evaluator
+    transpositionTable.clear();
+    return true;
+}
+
+bool isNetworkLoaded(){
+    return network.featureWeights != nullptr;
+}
+
+/**
+ * Index of the weight column for piece on squareIndex as seen by
+ * perspective. Black sees the board flipped, so both perspectives see
+ * their own pieces first and moving up the board
+*/
+static const int16_t* featureColumn(Color perspective, Piece piece, int squareIndex){
+    int relativeColor = (colorOf(piece) == perspective) ? 0 : 1;
+    int relativeSquare = (perspective == WHITE) ? squareIndex : (squareIndex ^ 56);
+    int feature = (relativeColor * 6 + typeOf(piece) - PAWN) * 64 + relativeSquare;
+    return network.featureWeights + size_t(feature) * NNUE_HIDDEN;
+}
+
+void refreshAccumulator(Accumulator& accumulator, Board& board){
+    for(int perspective = WHITE; perspective <= BLACK; perspective++){
+        std::memcpy(accumulator.values[perspective], network.featureBiases, sizeof(accumulator.values[perspective]));
+    }
+    Bitboard occupied = board.getOccupied();
+    while(occupied){
+        int squareIndex = popLSB(occupied);
+        addPiece(accumulator, board.getSquares()[squareIndex], squareIndex);
+    }
+}
+
+void addPiece(Accumulator& accumulator, Piece piece, int squareIndex){
+    addColumn(accumulator.values[WHITE], featureColumn(WHITE, piece, squareIndex));
+    addColumn(accumulator.values[BLACK], featureColumn(BLACK, piece, squareIndex));
+}
+
+void removePiece(Accumulator& accumulator, Piece piece, int squareIndex){
+    subtractColumn(accumulator.values[WHITE], featureColumn(WHITE, piece, squareIndex));
+    subtractColumn(accumulator.values[BLACK], featureColumn(BLACK, piece, squareIndex));
+}
+
+void updateAccumulator(const Accumulator& parent, Accumulator& child, Board& board, PackedMove move){
+    int source = move.sourceSquare();
+    int target = move.targetSquare();
+    const Piece* squares = board.getSquares();
+    Piece movingPiece = squares[source];
+    Piece placedPiece = movingPiece;
+    if(move.flag() == PackedMove::PROMOTION_FLAG){
+        placedPiece = Piece(movingPiece > 0 ? move.promotedType() : -move.promotedType());
+    }
+
+    child = parent;
+    removePiece(child, movingPiece, source);
+    //The pawn taken en passant sits behind the target square
+    if(move.flag() == PackedMove::EN_PASSANT_FLAG){
+        int capturedSquare = target + (movingPiece > 0 ? -8 : 8);
+        removePiece(child, squares[capturedSquare], capturedSquare);
+    }
+    else if(squares[target] != EMPTY){
+        removePiece(child, squares[target], target);
+    }
+    if(move.flag() == PackedMove::CASTLING_FLAG){
+        int rookSource = (target > source) ? source+3 : source-4;
+        int rookTarget = (target > source) ? source+1 : source-1;
+        removePiece(child, squares[rookSource], rookSource);
+        addPiece(child, squares[rookSource], rookTarget);
+    }
+    addPiece(child, placedPiece, target);
+}
+
+int evaluateNetwork(const Accumulator& accumulator, Color sideToMove){
+    Color opponent = (sideToMove == WHITE) ? BLACK : WHITE;
+    int64_t output = outputLayer(accumulator.values[sideToMove], accumulator.values[opponent], network.outputWeights);
+    output += network.outputBias;
+    return int(output * NNUE_OUTPUT_SCALE / (NNUE_CLIP * NNUE_OUTPUT_QUANT));
+}
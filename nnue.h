@@ -0,0 +1,54 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <cstdint>
+#include <string>
+
+#include "board.h"
+
+/**
+ * Efficiently updatable neural network evaluation.
+ *
+ * Inputs are one feature per piece: its colour relative to the perspective,
+ * its type and its square (768 in all). The feature transformer turns the
+ * active features into NNUE_HIDDEN int16 values per perspective, white's and
+ * black's with the board flipped. Its output only changes by one weight
+ * column per piece added or removed, so the search keeps one Accumulator per
+ * ply, each built from its parent and the move between them, instead of
+ * recomputing it. The output layer takes both halves through a clipped ReLU,
+ * the side to move's half first.
+ *
+ * Network file layout, little endian:
+ *   char magic[4] "AONN", uint32 version (1), uint32 hidden size (NNUE_HIDDEN)
+ *   int16 featureWeights[768][NNUE_HIDDEN], int16 featureBiases[NNUE_HIDDEN]
+ *   int16 outputWeights[2 * NNUE_HIDDEN], int32 outputBias
+*/
+const int NNUE_INPUTS = 768;
+const int NNUE_HIDDEN = 256;
+const int NNUE_CLIP = 255;           //Clipped ReLU ceiling, feature transformer scale
+const int NNUE_OUTPUT_QUANT = 64;    //Output weight scale
+const int NNUE_OUTPUT_SCALE = 400;   //Network output units to centipawns
+
+struct alignas(64) Accumulator {
+    int16_t values[2][NNUE_HIDDEN];  //[perspective]
+};
+
+//Picks the AVX2, SSE4.1 or scalar kernels for this CPU. Must run before loadNetwork
+void initNnue();
+//Maps the network file into memory and clears the hash table. Returns false and keeps the current network if it is missing or malformed
+bool loadNetwork(const std::string& path);
+bool isNetworkLoaded();
+//Name of the kernels in use, for reports
+const char* nnueKernelName();
+
+//Recomputes from every piece on the board
+void refreshAccumulator(Accumulator& accumulator, Board& board);
+void addPiece(Accumulator& accumulator, Piece piece, int squareIndex);
+void removePiece(Accumulator& accumulator, Piece piece, int squareIndex);
+//child becomes parent with move applied. board is the position before move is made
+void updateAccumulator(const Accumulator& parent, Accumulator& child, Board& board, PackedMove move);
+
+//Score in centipawns from sideToMove's point of view
+int evaluateNetwork(const Accumulator& accumulator, Color sideToMove);
+
+#endif  // NNUE_H
@@ -0,0 +1,161 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "perft.h"
+
+uint64_t perft(Board& board, int depth){
+    if(depth == 0){
+        return 1;
+    }
+
+    MoveList moves;
+    board.generateLegalMoves(board.colorToMove(), moves);
+    //Every generated move is legal, so the last ply is just the list length
+    if(depth == 1){
+        return moves.size();
+    }
+    uint64_t nodes = 0;
+
+    for(PackedMove move : moves){
+        UndoInfo undo;
+        board.makeMove(move, undo);
+        nodes += perft(board, depth-1);
+        board.unmakeMove(move, undo);
+    }
+    return nodes;
+}
+
+uint64_t divide(Board& board, int depth){
+    MoveList moves;
+    board.generateLegalMoves(board.colorToMove(), moves);
+
+    uint64_t total = 0;
+    for(PackedMove move : moves){
+        UndoInfo undo;
+        board.makeMove(move, undo);
+        uint64_t nodes = perft(board, depth-1);
+        board.unmakeMove(move, undo);
+        std::cout << board.moveToString(move) << ": " << nodes << std::endl;
+        total += nodes;
+    }
+    return total;
+}
+
+/**
+ * One EPD record. expectedNodes[d] is 0 when the file gives no count for depth d
+*/
+struct PerftPosition {
+    std::string fen;
+    uint64_t expectedNodes[32] = {};
+};
+
+static bool parseEPDLine(const std::string& line, PerftPosition& position){
+    //Everything before the first ';' is the position, the rest are ";D<depth> <nodes>" operations
+    std::string::size_type operationStart = line.find(';');
+    std::string fen = line.substr(0, operationStart);
+
+    std::stringstream fields(fen);
+    std::string field;
+    int fieldCount = 0;
+    while(fields >> field){
+        fieldCount++;
+    }
+    if(fieldCount < 4){
+        return false;
+    }
+    //EPD leaves out the move counters
+    position.fen = fen.substr(0, fen.find_last_not_of(' ') + 1);
+    if(fieldCount == 4){
+        position.fen += " 0 1";
+    }
+
+    while(operationStart != std::string::npos){
+        std::string::size_type operationEnd = line.find(';', operationStart + 1);
+        std::stringstream operation(line.substr(operationStart + 1, operationEnd - operationStart - 1));
+        std::string opcode;
+        uint64_t nodes = 0;
+        if(operation >> opcode >> nodes && opcode.size() > 1 && opcode[0] == 'D'){
+            int depth = std::atoi(opcode.c_str() + 1);
+            if(depth > 0 && depth < 32){
+                position.expectedNodes[depth] = nodes;
+            }
+        }
+        operationStart = operationEnd;
+    }
+    return true;
+}
+
+int runPerftSuite(const std::string& epdPath, int depth, bool divideMode){
+    std::ifstream file(epdPath);
+    if(!file.is_open()){
+        std::cout << "Failed to open " << epdPath << std::endl;
+        return 1;
+    }
+    if(depth < 1 || depth > 31){
+        std::cout << "Depth must be between 1 and 31" << std::endl;
+        return 1;
+    }
+
+    std::string line;
+    int positionNumber = 0;
+    int failures = 0;
+    uint64_t totalNodes = 0;
+    double totalSeconds = 0;
+
+    while(std::getline(file, line)){
+        if(!line.empty() && line.back() == '\r'){
+            line.pop_back();
+        }
+        if(line.empty() || line.find("//") == 0 || line[0] == '#'){
+            continue;
+        }
+
+        PerftPosition position;
+        if(!parseEPDLine(line, position)){
+            std::cout << "Skipping malformed line: " << line << std::endl;
+            continue;
+        }
+        positionNumber++;
+
+        Board board;
+        FenError error = board.parseFEN(position.fen);
+        if(error != FEN_OK){
+            std::cout << "Skipping invalid position (" << fenErrorMessage(error) << "): " << line << std::endl;
+            positionNumber--;
+            continue;
+        }
+        std::cout << "Position " << positionNumber << ": " << position.fen << std::endl;
+
+        auto startTime = std::chrono::steady_clock::now();
+        uint64_t nodes;
+        if(divideMode){
+            nodes = divide(board, depth);
+        }
+        else{
+            nodes = perft(board, depth);
+        }
+        auto endTime = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(endTime - startTime).count();
+
+        totalNodes += nodes;
+        totalSeconds += seconds;
+
+        uint64_t expected = position.expectedNodes[depth];
+        std::cout << "  depth " << depth << "  nodes " << nodes;
+        if(expected != 0){
+            std::cout << "  expected " << expected << (nodes == expected ? "  OK" : "  FAIL");
+            if(nodes != expected){
+                failures++;
+            }
+        }
+        std::cout << "  time " << static_cast<uint64_t>(seconds * 1000) << " ms"
+                  << "  nps " << static_cast<uint64_t>(seconds > 0 ? nodes / seconds : 0) << std::endl;
+    }
+
+    std::cout << "\nTotal: " << totalNodes << " nodes in " << static_cast<uint64_t>(totalSeconds * 1000) << " ms"
+              << ", nps " << static_cast<uint64_t>(totalSeconds > 0 ? totalNodes / totalSeconds : 0)
+              << ", " << failures << " mismatches" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+#ifndef PERFT_H
+#define PERFT_H
+
+#include <cstdint>
+#include <string>
+
+#include "board.h"
+
+//Counts leaf nodes of the legal move tree to the given depth
+uint64_t perft(Board& board, int depth);
+
+//Perft split by root move, printed one line per move. Returns the total
+uint64_t divide(Board& board, int depth);
+
+/**
+ * Runs perft (or divide) on every position of an EPD file and reports nodes,
+ * wall time and nodes/second. Expected counts are read from ";D<depth> <nodes>"
+ * operations. Returns 0 when every position with an expected count matched.
+*/
+int runPerftSuite(const std::string& epdPath, int depth, bool divideMode);
+
+#endif  // PERFT_H
@@ -0,0 +1,511 @@
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include "eval.h"
+#include "search.h"
+#include "tt.h"
+
+//Width of the first aspiration window around the previous iteration's score
+const int ASPIRATION_WINDOW = 25;
+//The main thread looks at the clock once per this many nodes (a power of two)
+const uint64_t TIME_CHECK_INTERVAL = 1024;
+//Quiescence skips captures that cannot raise alpha even when winning this much beyond the captured piece
+const int DELTA_MARGIN = 200;
+
+/**
+ * Lazy SMP depth skipping. Helper n searches depth d only when
+ * ((d + skipPhase[n]) / skipSize[n]) is even, so helpers run ahead of and
+ * behind the main thread instead of all repeating the same iteration.
+*/
+const int SKIP_PATTERNS = 20;
+const int skipSize[SKIP_PATTERNS]  = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+const int skipPhase[SKIP_PATTERNS] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+/**
+ * Mate scores are stored relative to the node instead of the root, so that
+ * the same entry is correct when reached at a different ply
+*/
+static int scoreToTT(int score, int ply){
+    if(score >= MATE_BOUND) return score + ply;
+    if(score <= -MATE_BOUND) return score - ply;
+    return score;
+}
+
+static int scoreFromTT(int score, int ply){
+    if(score >= MATE_BOUND) return score - ply;
+    if(score <= -MATE_BOUND) return score + ply;
+    return score;
+}
+
+static char sideChar(Board& board){
+    return board.colorToMove() == WHITE ? 'w' : 'b';
+}
+
+Search::Search(const Board& root, const SearchLimits& limits, const std::vector<uint64_t>& previousKeys, int threadCount,
+               TranspositionTable& table)
+    : board(root), table(table), limits(limits), stopped(false), pondering(limits.ponder), nodes(0), threadId(0){
+    if(isNetworkLoaded()){
+        accumulators.reset(new Accumulator[MAX_PLY]);
+        refreshAccumulator(accumulators[0], board);
+    }
+
+    //Reserve once so pushing keys during the search never reallocates
+    keyHistory.reserve(previousKeys.size() + MAX_PLY + 1);
+    keyHistory = previousKeys;
+    keyHistory.push_back(board.getZobristKey());
+    rootHistorySize = keyHistory.size();
+
+    clockStart = 0;
+
+    bestScore = 0;
+    completedDepth = 0;
+    for(int ply = 0; ply < MAX_PLY; ply++){
+        pvLength[ply] = 0;
+        killers[ply][0] = PackedMove();
+        killers[ply][1] = PackedMove();
+        moveStack[ply] = PackedMove();
+    }
+    history.clear();
+
+    for(int helper = 1; helper < threadCount; helper++){
+        helpers.emplace_back(new Search(root, limits, previousKeys, 1, table));
+        helpers.back()->threadId = helper;
+    }
+}
+
+Search::~Search(){
+    stop();
+    for(std::thread& helperThread : helperThreads){
+        helperThread.join();
+    }
+}
+
+PackedMove Search::think(){
+    startTime = std::chrono::steady_clock::now();
+    if(threadId == 0){
+        table.newSearch();
+        for(std::unique_ptr<Search>& helper : helpers){
+            Search* helperSearch = helper.get();
+            helperThreads.emplace_back([helperSearch]{ helperSearch->think(); });
+        }
+    }
+
+    //Fall back to any legal move if not even depth 1 completes
+    {
+        MoveList moves;
+        board.generateLegalMoves(board.colorToMove(), moves);
+        if(moves.size() > 0){
+            bestMove = moves[0];
+        }
+        if(threadId == 0){
+            timeManager.init(limits, board.colorToMove(), moves.size());
+            if(!limits.silent && timeManager.getHardLimit() > 0){
+                printLine("info string time soft " + std::to_string(timeManager.getSoftLimit())
+                          + " ms hard " + std::to_string(timeManager.getHardLimit()) + " ms");
+            }
+        }
+    }
+
+    int score = 0;
+    for(int depth = 1; depth <= limits.depth && depth < MAX_PLY; depth++){
+        if(threadId > 0){
+            int pattern = (threadId - 1) % SKIP_PATTERNS;
+            if(((depth + skipPhase[pattern]) / skipSize[pattern]) % 2){
+                continue;
+            }
+        }
+
+        int delta = ASPIRATION_WINDOW;
+        int alpha = -INFINITE_SCORE;
+        int beta = INFINITE_SCORE;
+        if(depth >= 4){
+            alpha = std::max(score - delta, -INFINITE_SCORE);
+            beta = std::min(score + delta, INFINITE_SCORE);
+        }
+
+        //Re-search with a wider window until the score lands inside it
+        while(true){
+            int result = alphaBeta(depth, 0, alpha, beta);
+            if(stopped){
+                break;
+            }
+
+            if(result <= alpha){
+                beta = (alpha + beta) / 2;
+                alpha = std::max(result - delta, -INFINITE_SCORE);
+            }
+            else if(result >= beta){
+                beta = std::min(result + delta, INFINITE_SCORE);
+            }
+            else{
+                score = result;
+                break;
+            }
+            delta += delta;
+        }
+
+        if(stopped){
+            break;  //A partial iteration is not trusted, keep the last completed one
+        }
+
+        bestMove = pvTable[0][0];
+        ponderMove = pvLength[0] > 1 ? pvTable[0][1] : PackedMove();
+        bestScore = score;
+        completedDepth = depth;
+        if(threadId == 0){
+            if(!limits.silent){
+                reportIteration(depth, score);
+            }
+            timeManager.iterationDone(depth, bestMove, score);
+            if(!pondering && timeManager.shouldStop(elapsedMilliseconds() - clockStart)){
+                break;
+            }
+        }
+    }
+
+    //Helpers keep going until the main thread is done with them
+    if(threadId == 0){
+        for(std::unique_ptr<Search>& helper : helpers){
+            helper->stop();
+        }
+        for(std::thread& helperThread : helperThreads){
+            helperThread.join();
+        }
+        helperThreads.clear();
+    }
+    return bestMove;
+}
+
+int Search::alphaBeta(int depth, int ply, int alpha, int beta){
+    //Handed off before counting, quiescence counts the node itself
+    if(depth <= 0 || ply >= MAX_PLY - 1){
+        return quiescence(ply, alpha, beta);
+    }
+
+    pvLength[ply] = ply;
+    //Only this thread writes its counter, so a plain load and store is enough
+    nodes.store(nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    if(limits.nodes && nodes >= limits.nodes){
+        stopped = true;
+    }
+    if(threadId == 0 && (nodes & (TIME_CHECK_INTERVAL - 1)) == 0){
+        checkLimits();
+    }
+    if(stopped){
+        return 0;
+    }
+
+    bool rootNode = ply == 0;
+    bool pvNode = beta - alpha > 1;
+    if(!rootNode && isDraw(ply)){
+        return 0;
+    }
+
+    uint64_t key = board.getZobristKey();
+    TTData entry;
+    bool ttHit = table.probe(key, entry);
+    PackedMove ttMove = ttHit ? entry.move : PackedMove();
+
+    if(ttHit && !pvNode && entry.depth >= depth){
+        int ttScore = scoreFromTT(entry.score, ply);
+        if(entry.bound == BOUND_EXACT
+           || (entry.bound == BOUND_LOWER && ttScore >= beta)
+           || (entry.bound == BOUND_UPPER && ttScore <= alpha)){
+            return ttScore;
+        }
+    }
+
+    int originalAlpha = alpha;
+    int bestNodeScore = -INFINITE_SCORE;
+    PackedMove bestNodeMove;
+    int legalMoves = 0;
+
+    //The reply that refuted the previous move elsewhere, looked up by the piece that made it and its target
+    Color us = board.colorToMove();
+    Color them = (us == WHITE) ? BLACK : WHITE;
+    PackedMove counterMove;
+    if(ply > 0 && !moveStack[ply - 1].isNull()){
+        int previousTarget = moveStack[ply - 1].targetSquare();
+        counterMove = history.counterMoves[them][typeOf(board.getSquares()[previousTarget])][previousTarget];
+    }
+
+    PackedMove triedQuiets[64];
+    int triedQuietCount = 0;
+
+    //Hash move first, then captures, with quiet moves only generated if nothing cuts off before them
+    MovePicker picker(board, ttMove, killers[ply], &history, counterMove);
+    for(PackedMove move = picker.nextMove(); !move.isNull(); move = picker.nextMove()){
+        bool quiet = !board.isCaptureOrPromotion(move);
+        UndoInfo undo;
+        makeMove(move, undo, ply);
+        //The child probes this bucket first thing, start loading it now
+        table.prefetch(board.getZobristKey());
+        moveStack[ply] = move;
+        legalMoves++;
+        keyHistory.push_back(board.getZobristKey());
+
+        int score;
+        if(legalMoves == 1){
+            score = -alphaBeta(depth - 1, ply + 1, -beta, -alpha);
+        }
+        else{
+            //Later moves only need to prove they are worse than the first; re-search if not
+            score = -alphaBeta(depth - 1, ply + 1, -alpha - 1, -alpha);
+            if(score > alpha && score < beta){
+                score = -alphaBeta(depth - 1, ply + 1, -beta, -alpha);
+            }
+        }
+
+        keyHistory.pop_back();
+        board.unmakeMove(move, undo);
+
+        if(stopped){
+            return 0;
+        }
+
+        if(score > bestNodeScore){
+            bestNodeScore = score;
+            bestNodeMove = move;
+
+            if(score > alpha){
+                alpha = score;
+
+                pvTable[ply][ply] = move;
+                for(int next = ply + 1; next < pvLength[ply + 1]; next++){
+                    pvTable[ply][next] = pvTable[ply + 1][next];
+                }
+                pvLength[ply] = pvLength[ply + 1];
+
+                if(alpha >= beta){
+                    if(quiet){
+                        updateQuietStats(move, ply, depth, triedQuiets, triedQuietCount);
+                    }
+                    break;
+                }
+            }
+        }
+        if(quiet && triedQuietCount < 64){
+            triedQuiets[triedQuietCount++] = move;
+        }
+    }
+
+    if(legalMoves == 0){
+        return board.isKingInCheck(sideChar(board)) ? -MATE_SCORE + ply : 0;
+    }
+
+    Bound bound = (bestNodeScore >= beta) ? BOUND_LOWER
+                : (bestNodeScore > originalAlpha) ? BOUND_EXACT : BOUND_UPPER;
+    table.store(key, bestNodeMove, scoreToTT(bestNodeScore, ply), depth, bound);
+
+    return bestNodeScore;
+}
+
+/**
+ * A quiet move caused a beta cutoff: make it a killer for this ply, the
+ * counter-move to the previous move, and shift history towards it and away
+ * from the quiet moves that failed before it
+*/
+void Search::updateQuietStats(PackedMove move, int ply, int depth, const PackedMove* triedQuiets, int triedCount){
+    if(killers[ply][0] != move){
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = move;
+    }
+
+    Color us = board.colorToMove();
+    Color them = (us == WHITE) ? BLACK : WHITE;
+    if(ply > 0 && !moveStack[ply - 1].isNull()){
+        int previousTarget = moveStack[ply - 1].targetSquare();
+        history.counterMoves[them][typeOf(board.getSquares()[previousTarget])][previousTarget] = move;
+    }
+    history.update(us, move, triedQuiets, triedCount, depth);
+}
+
+/**
+ * Searches only captures and promotions until the position is quiet, so
+ * the evaluation is never taken in the middle of an exchange. The side to
+ * move may stand pat on the static evaluation instead of capturing. When in
+ * check every evasion is searched instead, and no evasion means mate.
+*/
+int Search::quiescence(int ply, int alpha, int beta){
+    pvLength[ply] = ply;
+    nodes.store(nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    if(limits.nodes && nodes >= limits.nodes){
+        stopped = true;
+    }
+    if(threadId == 0 && (nodes & (TIME_CHECK_INTERVAL - 1)) == 0){
+        checkLimits();
+    }
+    if(stopped){
+        return 0;
+    }
+
+    int standPat = evaluate(board, accumulators ? &accumulators[ply] : nullptr);
+    if(ply >= MAX_PLY - 1){
+        return standPat;
+    }
+
+    bool inCheck = board.isKingInCheck(sideChar(board));
+    int bestScore = -INFINITE_SCORE;
+    if(!inCheck){
+        if(standPat >= beta){
+            return standPat;
+        }
+        alpha = std::max(alpha, standPat);
+        bestScore = standPat;
+    }
+
+    MovePicker picker = inCheck ? MovePicker(board, PackedMove(), nullptr) : MovePicker(board, PackedMove());
+    int moveCount = 0;
+    for(PackedMove move = picker.nextMove(); !move.isNull(); move = picker.nextMove()){
+        moveCount++;
+        if(!inCheck){
+            //Delta pruning: even winning the captured piece with a margin to spare would not reach alpha
+            Piece captured = board.getSquares()[move.targetSquare()];
+            int capturedValue = (move.flag() == PackedMove::EN_PASSANT_FLAG) ? pieceValues[PAWN] : pieceValues[typeOf(captured)];
+            if(move.flag() != PackedMove::PROMOTION_FLAG && standPat + capturedValue + DELTA_MARGIN <= alpha){
+                continue;
+            }
+            //Captures that lose material are not worth resolving
+            if(board.see(move) < 0){
+                continue;
+            }
+        }
+
+        UndoInfo undo;
+        makeMove(move, undo, ply);
+        int score = -quiescence(ply + 1, -beta, -alpha);
+        board.unmakeMove(move, undo);
+
+        if(stopped){
+            return 0;
+        }
+        if(score > bestScore){
+            bestScore = score;
+            if(score > alpha){
+                alpha = score;
+                if(alpha >= beta){
+                    break;
+                }
+            }
+        }
+    }
+
+    if(inCheck && moveCount == 0){
+        return -MATE_SCORE + ply;
+    }
+    return bestScore;
+}
+
+/**
+ * Fifty-move rule, or a repetition since the last irreversible move. One
+ * repeat is enough when the earlier position lies inside the search tree,
+ * since the side that allowed it could repeat again. Positions from the game
+ * before the root, the root included, only count as an actual threefold.
+ * Only positions with the same side to move can match.
+*/
+bool Search::isDraw(int ply){
+    int halfMoveClock = board.getHalfMoveClock();
+    if(halfMoveClock >= 100){
+        return true;
+    }
+
+    int root = rootHistorySize - 1;
+    int current = root + ply;
+    int oldest = std::max(0, current - halfMoveClock);
+    int gameRepetitions = 0;
+    for(int index = current - 2; index >= oldest; index -= 2){
+        if(keyHistory[index] == keyHistory[current]){
+            if(index > root || ++gameRepetitions == 2){
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void Search::makeMove(PackedMove move, UndoInfo& undo, int ply){
+    if(accumulators){
+        updateAccumulator(accumulators[ply], accumulators[ply + 1], board, move);
+    }
+    board.makeMove(move, undo);
+}
+
+void Search::checkLimits(){
+    if(!pondering && timeManager.hardLimitReached(elapsedMilliseconds() - clockStart)){
+        stopped = true;
+    }
+    if(limits.nodes && getNodes() >= limits.nodes){
+        stopped = true;
+    }
+}
+
+void Search::stop(){
+    stopped = true;
+    for(std::unique_ptr<Search>& helper : helpers){
+        helper->stop();
+    }
+}
+
+void Search::ponderhit(){
+    clockStart = elapsedMilliseconds();
+    pondering = false;
+}
+
+int64_t Search::elapsedMilliseconds() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+std::string formatScore(int score){
+    if(score >= MATE_BOUND){
+        return "mate " + std::to_string((MATE_SCORE - score + 1) / 2);
+    }
+    if(score <= -MATE_BOUND){
+        return "mate -" + std::to_string((MATE_SCORE + score) / 2);
+    }
+    return "cp " + std::to_string(score);
+}
+
+void printLine(const std::string& text){
+    static std::mutex outputMutex;
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << text << '\n' << std::flush;
+}
+
+void Search::reportIteration(int depth, int score){
+    int64_t elapsed = elapsedMilliseconds();
+    uint64_t totalNodes = getNodes();
+    uint64_t nps = elapsed > 0 ? totalNodes * 1000 / elapsed : 0;
+    std::ostringstream out;
+
+    out << "info depth " << depth << " score " << formatScore(score) << " nodes " << totalNodes << " nps " << nps << " time " << elapsed
+        << " hashfull " << table.hashfull() << " pv";
+
+    for(int ply = 0; ply < pvLength[0]; ply++){
+        out << " " << board.moveToString(pvTable[0][ply]);
+    }
+    printLine(out.str());
+}
+
+uint64_t Search::getNodes() const {
+    uint64_t total = nodes.load(std::memory_order_relaxed);
+    for(const std::unique_ptr<Search>& helper : helpers){
+        total += helper->getNodes();
+    }
+    return total;
+}
+
+int Search::getScore() const {
+    return bestScore;
+}
+
+int Search::getCompletedDepth() const {
+    return completedDepth;
+}
+
+PackedMove Search::getPonderMove() const {
+    return ponderMove;
+}
@@ -0,0 +1,132 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "board.h"
+#include "movepicker.h"
+#include "nnue.h"
+#include "timeman.h"
+#include "tt.h"
+
+const int MAX_PLY = 128;
+const int INFINITE_SCORE = 32000;
+const int MATE_SCORE = 31000;                    //Mate at ply p scores MATE_SCORE - p
+const int MATE_BOUND = MATE_SCORE - MAX_PLY;     //Scores beyond this are mates
+
+//UCI score text: "cp <centipawns>" or "mate <moves>", negative when being mated
+std::string formatScore(int score);
+
+//Writes text and a newline to standard output in one piece and flushes. The search and
+//UCI threads print only through this, so their lines never run into each other
+void printLine(const std::string& text);
+
+/**
+ * When to stop searching. A value of 0 means no limit of that kind.
+*/
+struct SearchLimits {
+    int depth = MAX_PLY - 1;
+    uint64_t nodes = 0;
+    int64_t moveTime = 0;  //Milliseconds
+    //Clock state from a UCI go command, milliseconds, indexed by Color
+    int64_t time[2] = {0, 0};
+    int64_t increment[2] = {0, 0};
+    int movesToGo = 0;
+    //Searching on the opponent's time: no time limit applies until ponderhit
+    bool ponder = false;
+    //No info lines, for batch analysis
+    bool silent = false;
+};
+
+/**
+ * Negamax alpha-beta with principal variation search, driven by iterative
+ * deepening with aspiration windows. Searches its own copy of the position
+ * and shares results with other searches only through the transposition table,
+ * the global one unless another is given.
+ *
+ * With more than one thread this is Lazy SMP: the Search created by the
+ * caller is the main thread and owns threadCount - 1 helpers. Each helper has
+ * its own Board copy, PV and heuristics and searches the same root on its own
+ * thread, skipping some depths so threads spread over different iterations.
+ * Only the main thread checks limits, reports and picks the move.
+*/
+class Search {
+    public:
+        //previousKeys are the Zobrist keys of the game so far, for repetition detection.
+        //table is shared by all threads of this search and must outlive it
+        Search(const Board& root, const SearchLimits& limits, const std::vector<uint64_t>& previousKeys = {}, int threadCount = 1,
+               TranspositionTable& table = transpositionTable);
+        ~Search();
+
+        //Searches until a limit is hit, printing one info line per completed depth
+        PackedMove think();
+        //Safe to call from another thread. Stopping the main thread stops its helpers
+        void stop();
+        //Safe to call from another thread. The predicted move was played, time limits apply from now
+        void ponderhit();
+
+        //Nodes searched by this thread and all its helpers
+        uint64_t getNodes() const;
+        int getScore() const;
+        int getCompletedDepth() const;
+        //Second move of the last completed PV, null if there is none
+        PackedMove getPonderMove() const;
+
+    private:
+        int alphaBeta(int depth, int ply, int alpha, int beta);
+        int quiescence(int ply, int alpha, int beta);
+        //Makes move on board, first building the network accumulator of ply + 1 when there is one
+        void makeMove(PackedMove move, UndoInfo& undo, int ply);
+        void updateQuietStats(PackedMove move, int ply, int depth, const PackedMove* triedQuiets, int triedCount);
+        bool isDraw(int ply);
+        void checkLimits();
+        void reportIteration(int depth, int score);
+        int64_t elapsedMilliseconds() const;
+
+        Board board;
+        TranspositionTable& table;
+        //Network accumulators for this thread, one per ply, null when no network is loaded.
+        //Each child is built from its parent before the move is made, so unmaking costs nothing
+        std::unique_ptr<Accumulator[]> accumulators;
+        SearchLimits limits;
+        std::atomic<bool> stopped;
+        std::atomic<bool> pondering;
+        std::chrono::steady_clock::time_point startTime;
+        //Time limits count from here: 0, or the moment of ponderhit
+        std::atomic<int64_t> clockStart;
+        //Main thread only
+        TimeManager timeManager;
+        //Written only by the owning thread, read by the main thread for totals
+        std::atomic<uint64_t> nodes;
+
+        int threadId;  //0 for the main thread
+        std::vector<std::unique_ptr<Search>> helpers;
+        std::vector<std::thread> helperThreads;
+
+        //Keys of every position from the game start to the current ply
+        std::vector<uint64_t> keyHistory;
+        int rootHistorySize;
+
+        //Triangular PV table, pvTable[ply] holds the best line found from ply
+        PackedMove pvTable[MAX_PLY][MAX_PLY];
+        int pvLength[MAX_PLY];
+
+        //Move ordering, private to this thread. Two quiet moves per ply that last caused a cutoff there
+        PackedMove killers[MAX_PLY][2];
+        MoveHistory history;
+        //Move made at each ply on the current line, for counter-moves
+        PackedMove moveStack[MAX_PLY];
+
+        PackedMove bestMove;
+        PackedMove ponderMove;
+        int bestScore;
+        int completedDepth;
+};
+
+#endif  // SEARCH_H
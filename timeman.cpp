@@ -0,0 +1,102 @@
+#include <algorithm>
+
+#include "search.h"
+#include "timeman.h"
+
+//Time kept back for communication lag with the GUI on every move
+const int64_t MOVE_OVERHEAD = 30;
+//Moves assumed to be left in sudden death
+const int DEFAULT_MOVES_TO_GO = 30;
+//The hard limit allows this many soft limits, but never more than HARD_LIMIT_SHARE of what is left
+const int HARD_LIMIT_FACTOR = 4;
+const double HARD_LIMIT_SHARE = 0.5;
+
+TimeManager::TimeManager(){
+    enabled = false;
+    fixedTime = false;
+    singleMove = false;
+    softLimit = 0;
+    hardLimit = 0;
+    bestMoveInstability = 0;
+    stableIterations = 0;
+    scoreDrop = 0;
+    previousScore = 0;
+    completedDepth = 0;
+}
+
+void TimeManager::init(const SearchLimits& limits, Color side, int legalMoves){
+    *this = TimeManager();
+    singleMove = legalMoves <= 1;
+
+    if(limits.moveTime > 0){
+        enabled = true;
+        fixedTime = true;
+        softLimit = limits.moveTime;
+        hardLimit = limits.moveTime;
+        return;
+    }
+    if(limits.time[side] <= 0){
+        return;
+    }
+
+    enabled = true;
+    int64_t available = std::max<int64_t>(1, limits.time[side] - MOVE_OVERHEAD);
+    int movesToGo = limits.movesToGo > 0 ? std::min(limits.movesToGo, DEFAULT_MOVES_TO_GO) : DEFAULT_MOVES_TO_GO;
+
+    //An even share of what is left, plus most of the increment that comes back after the move
+    softLimit = available / movesToGo + limits.increment[side] * 3 / 4;
+    //The last move before a time control may use nearly everything
+    double share = movesToGo == 1 ? 0.9 : HARD_LIMIT_SHARE;
+    hardLimit = std::min<int64_t>(softLimit * HARD_LIMIT_FACTOR, int64_t(available * share));
+    hardLimit = std::max<int64_t>(1, hardLimit);
+    softLimit = std::max<int64_t>(1, std::min(softLimit, hardLimit));
+}
+
+void TimeManager::iterationDone(int depth, PackedMove bestMove, int score){
+    bestMoveInstability /= 2;
+    if(completedDepth > 0 && bestMove != previousBestMove){
+        bestMoveInstability += 1;
+        stableIterations = 0;
+    }
+    else{
+        stableIterations++;
+    }
+    scoreDrop = completedDepth > 0 ? std::max(0, previousScore - score) : 0;
+
+    previousBestMove = bestMove;
+    previousScore = score;
+    completedDepth = depth;
+}
+
+bool TimeManager::shouldStop(int64_t elapsed) const {
+    if(!enabled){
+        return false;
+    }
+    if(singleMove && completedDepth >= 1){
+        return true;
+    }
+    if(fixedTime){
+        return false;
+    }
+
+    //Up to 2.5 times the soft limit while the best move flips, less once it has settled
+    double scale = 1.0 + bestMoveInstability;
+    if(scoreDrop > 20){
+        scale += std::min(scoreDrop, 100) / 100.0;
+    }
+    if(stableIterations >= 6){
+        scale *= 0.6;
+    }
+    scale = std::min(scale, 2.5);
+
+    //The next depth usually takes longer than all the ones before it, so starting it late is wasted
+    return elapsed >= int64_t(softLimit * scale * 0.6);
+}
+
+int64_t TimeManager::getSoftLimit() const {
+    return softLimit;
+}
+
+int64_t TimeManager::getHardLimit() const {
+    return hardLimit;
+}
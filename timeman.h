@@ -0,0 +1,59 @@
+#ifndef TIMEMAN_H
+#define TIMEMAN_H
+
+#include <cstdint>
+
+#include "board.h"
+
+struct SearchLimits;
+
+/**
+ * Turns the clock into two limits for one move. The soft limit is checked
+ * between iterations: once most of it is used no new depth is started. The hard
+ * limit is checked inside the search every thousand or so nodes and aborts the
+ * iteration in progress, so a move never takes longer than it.
+ *
+ * The soft limit stretches while the best move keeps changing or the score
+ * drops between iterations, and shrinks while both stay put. With only one
+ * legal move there is nothing to decide and the search stops after depth 1.
+ *
+ * All times are milliseconds from the moment the clock started for this move.
+*/
+class TimeManager {
+    public:
+        //No limits until init is called
+        TimeManager();
+
+        //Works out the limits for side from the go command's clock fields or movetime
+        void init(const SearchLimits& limits, Color side, int legalMoves);
+
+        //Called by the main thread after each completed depth
+        void iterationDone(int depth, PackedMove bestMove, int score);
+        //True when the next iteration should not be started
+        bool shouldStop(int64_t elapsed) const;
+        bool hardLimitReached(int64_t elapsed) const {
+            return hardLimit > 0 && elapsed >= hardLimit;
+        }
+
+        //0 while no clock or movetime was given
+        int64_t getSoftLimit() const;
+        int64_t getHardLimit() const;
+
+    private:
+        bool enabled;
+        bool fixedTime;       //movetime: spend exactly that, no scaling
+        bool singleMove;      //Nothing to choose between: one legal move or none
+        int64_t softLimit;
+        int64_t hardLimit;
+
+        //Decaying count of best move changes between iterations
+        double bestMoveInstability;
+        //Iterations in a row that kept the same best move
+        int stableIterations;
+        int scoreDrop;        //How far the score fell in the last iteration, centipawns
+        PackedMove previousBestMove;
+        int previousScore;
+        int completedDepth;
+};
+
+#endif  // TIMEMAN_H
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "trace.h"
+
+#if ALPHAOMEGA_TRACE_RING
+TraceRing traceRing;
+
+void TraceRing::write(const std::string& line){
+    uint64_t claim = head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots[claim & (CAPACITY - 1)];
+
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    size_t length = std::min(line.size(), size_t(LINE_SIZE - 1));
+    std::memcpy(slot.text, line.data(), length);
+    slot.text[length] = '\0';
+    slot.sequence.store(claim + 1, std::memory_order_release);
+}
+
+void TraceRing::dump(std::ostream& out) const {
+    uint64_t end = head.load(std::memory_order_acquire);
+    uint64_t begin = end > uint64_t(CAPACITY) ? end - CAPACITY : 0;
+
+    for(uint64_t claim = begin; claim < end; claim++){
+        const Slot& slot = slots[claim & (CAPACITY - 1)];
+        if(slot.sequence.load(std::memory_order_acquire) != claim + 1){
+            continue;
+        }
+        char text[LINE_SIZE];
+        std::memcpy(text, slot.text, LINE_SIZE);
+        //A writer that reused the slot meanwhile has changed the sequence first
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(slot.sequence.load(std::memory_order_relaxed) != claim + 1){
+            continue;
+        }
+        text[LINE_SIZE - 1] = '\0';
+        out << text << '\n';
+    }
+    out.flush();
+}
+
+void TraceRing::clear(){
+    for(Slot& slot : slots){
+        slot.sequence.store(0, std::memory_order_relaxed);
+    }
+    head.store(0, std::memory_order_release);
+}
+
+#endif
+
+void traceWrite(const std::string& line){
+#if ALPHAOMEGA_TRACE_RING
+    traceRing.write(line);
+#else
+    std::cerr << line + '\n';
+#endif
+}
+
+bool traceDump(std::ostream& out){
+#if ALPHAOMEGA_TRACE_RING
+    traceRing.dump(out);
+    return true;
+#else
+    (void)out;
+    return false;
+#endif
+}
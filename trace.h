@@ -0,0 +1,82 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+/**
+ * Diagnostic tracing with the level fixed at compile time. Build with
+ * -DALPHAOMEGA_TRACE_LEVEL=<n> to keep every trace up to level n; the default
+ * of 0 discards them all, so release builds pay nothing for them. Traces go to
+ * std::cerr, or with -DALPHAOMEGA_TRACE_RING=1 into traceRing instead, which is
+ * only defined in that build and is printed by traceDump.
+ *
+ *     TRACE(TRACE_MOVES, "Moving rook from " << source << " to " << target);
+*/
+#ifndef ALPHAOMEGA_TRACE_LEVEL
+#define ALPHAOMEGA_TRACE_LEVEL 0
+#endif
+
+#ifndef ALPHAOMEGA_TRACE_RING
+#define ALPHAOMEGA_TRACE_RING 0
+#endif
+
+enum TraceLevel {
+    TRACE_OFF,
+    TRACE_INFO,    //Once per call, e.g. the parsed FEN fields
+    TRACE_DEBUG,   //Once per piece or query, e.g. FEN pieces and check tests
+    TRACE_MOVES    //Every move the generators produce
+};
+
+#if ALPHAOMEGA_TRACE_RING
+/**
+ * Fixed size in-memory log that keeps the most recent lines. Any thread can
+ * write without locking: a writer claims a slot with one fetch_add and marks
+ * it with its sequence number when done, so dump() skips slots that are
+ * being written or were overwritten while it read them.
+*/
+class TraceRing {
+    public:
+        static const int LINE_SIZE = 120;
+        static const int CAPACITY = 4096;  //Power of two
+
+        void write(const std::string& line);
+        //Prints the retained lines oldest first
+        void dump(std::ostream& out) const;
+        void clear();
+
+    private:
+        struct Slot {
+            std::atomic<uint64_t> sequence;  //Claim number + 1 once written, 0 while writing
+            char text[LINE_SIZE];
+        };
+
+        std::atomic<uint64_t> head{0};
+        Slot slots[CAPACITY] = {};
+};
+
+extern TraceRing traceRing;
+#endif
+
+//Sends one finished line to the configured sink
+void traceWrite(const std::string& line);
+//Prints the ring's lines, or returns false without printing when there is no ring
+bool traceDump(std::ostream& out);
+
+/**
+ * The message is still type checked when tracing is off, but if constexpr
+ * drops it, so no formatting or I/O code is left in the generators.
+*/
+#define TRACE(level, message)                                       \
+    do {                                                            \
+        if constexpr ((level) <= ALPHAOMEGA_TRACE_LEVEL) {          \
+            std::ostringstream traceLine;                           \
+            traceLine << message;                                   \
+            traceWrite(traceLine.str());                            \
+        }                                                           \
+    } while(0)
+
+#endif  // TRACE_H
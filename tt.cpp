@@ -0,0 +1,136 @@
+#include "tt.h"
+
+TranspositionTable transpositionTable;
+
+/**
+ * Data word layout:
+ * bits 0-15 move, 16-31 score, 32-39 depth, 40-41 bound, 42-63 age
+*/
+static uint64_t packData(PackedMove move, int score, int depth, Bound bound, uint32_t age){
+    return uint64_t(move.data)
+         | uint64_t(uint16_t(score)) << 16
+         | uint64_t(uint8_t(depth)) << 32
+         | uint64_t(bound) << 40
+         | uint64_t(age) << 42;
+}
+
+static TTData unpackData(uint64_t data){
+    TTData unpacked;
+    unpacked.move.data = uint16_t(data);
+    unpacked.score = int16_t(data >> 16);
+    unpacked.depth = int8_t(data >> 32);
+    unpacked.bound = Bound((data >> 40) & 3);
+    return unpacked;
+}
+
+static uint32_t ageOf(uint64_t data){
+    return uint32_t(data >> 42);
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes, bool isolated) : isolated(isolated){
+    bucketMask = 0;
+    generation = 0;
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(size_t megabytes){
+    size_t bucketCount = 1;
+    while(bucketCount * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024){
+        bucketCount *= 2;
+    }
+
+    buckets.reset();  //Free the old table before allocating the new one
+    buckets.reset(new Bucket[bucketCount]);
+    bucketMask = bucketCount - 1;
+    clear();
+}
+
+void TranspositionTable::clear(){
+    for(uint64_t bucket = 0; bucket <= bucketMask; bucket++){
+        for(Entry& entry : buckets[bucket].entries){
+            entry.keyXorData.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation = 0;
+}
+
+void TranspositionTable::newSearch(){
+    generation.fetch_add(1, std::memory_order_relaxed);
+    //An isolated table would see entries from the search that had the same age, so it starts over instead
+    if(isolated && currentAge() == 0){
+        clear();
+        generation = 1;
+    }
+}
+
+bool TranspositionTable::probe(uint64_t key, TTData& data) const {
+    const Bucket& bucket = bucketFor(key);
+    for(const Entry& entry : bucket.entries){
+        uint64_t word = entry.data.load(std::memory_order_relaxed);
+        if((entry.keyXorData.load(std::memory_order_relaxed) ^ word) == key && word != 0
+           && (!isolated || ageOf(word) == currentAge())){
+            data = unpackData(word);
+            return data.bound != BOUND_NONE;
+        }
+    }
+    return false;
+}
+
+/**
+ * Stores into the entry already holding this key if there is one, otherwise
+ * replaces the entry that is shallowest once older searches are penalised.
+*/
+void TranspositionTable::store(uint64_t key, PackedMove move, int score, int depth, Bound bound){
+    Bucket& bucket = bucketFor(key);
+    Entry* replace = &bucket.entries[0];
+    int replaceWorth = 1 << 30;
+
+    for(Entry& entry : bucket.entries){
+        uint64_t word = entry.data.load(std::memory_order_relaxed);
+        int relativeAge = (currentAge() - ageOf(word)) & AGE_MASK;
+        //Isolated, an entry from another search counts as empty, so nothing of it may decide what is kept
+        bool stale = isolated && relativeAge != 0;
+        if(!stale && (entry.keyXorData.load(std::memory_order_relaxed) ^ word) == key){
+            //Keep the old best move when this search did not find one
+            if(move.isNull()){
+                move = unpackData(word).move;
+            }
+            replace = &entry;
+            break;
+        }
+
+        int worth = stale ? -(1 << 30) : unpackData(word).depth - 8 * relativeAge;
+        if(worth < replaceWorth){
+            replaceWorth = worth;
+            replace = &entry;
+        }
+    }
+
+    uint64_t word = packData(move, score, depth, bound, currentAge());
+    replace->data.store(word, std::memory_order_relaxed);
+    replace->keyXorData.store(key ^ word, std::memory_order_relaxed);
+}
+
+void TranspositionTable::prefetch(uint64_t key) const {
+    __builtin_prefetch(&bucketFor(key));
+}
+
+int TranspositionTable::hashfull() const {
+    int used = 0;
+    int sampled = 0;
+    for(uint64_t bucket = 0; bucket <= bucketMask && sampled < 1000; bucket++){
+        for(const Entry& entry : buckets[bucket].entries){
+            uint64_t word = entry.data.load(std::memory_order_relaxed);
+            if(word != 0 && ageOf(word) == currentAge()){
+                used++;
+            }
+            sampled++;
+        }
+    }
+    return sampled == 0 ? 0 : used * 1000 / sampled;
+}
+
+size_t TranspositionTable::getMegabytes() const {
+    return (bucketMask + 1) * sizeof(Bucket) / (1024 * 1024);
+}
@@ -0,0 +1,91 @@
+#ifndef TT_H
+#define TT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "board.h"
+
+enum Bound : uint8_t {
+    BOUND_NONE,
+    BOUND_UPPER,   //Fail low, score is at most this
+    BOUND_LOWER,   //Fail high, score is at least this
+    BOUND_EXACT
+};
+
+/**
+ * What a probe returns, unpacked from the 64 bit data word
+*/
+struct TTData {
+    PackedMove move;
+    int16_t score;
+    int8_t depth;
+    Bound bound;
+};
+
+/**
+ * Shared transposition table. Its size is a power of two number of 64 byte
+ * buckets, each bucket holding four entries in one cache line.
+ *
+ * An entry is two 64 bit words: the packed data and key ^ data. Threads read
+ * and write them with plain relaxed atomics and no locks. If two writers
+ * interleave, or a reader sees half of an update, the XOR no longer gives
+ * back the key and the probe simply misses.
+ *
+ * An isolated table keeps every search to itself: probes miss on entries
+ * written by earlier searches and stores overwrite them first, so a search
+ * gives the same result whatever was searched before, without clearing.
+*/
+class TranspositionTable {
+    public:
+        explicit TranspositionTable(size_t megabytes = 16, bool isolated = false);
+
+        //Reallocates to the largest power of two bucket count that fits. Clears the table
+        void resize(size_t megabytes);
+        void clear();
+        //Called once per search so entries from older searches are replaced first, or ignored when isolated
+        void newSearch();
+
+        bool probe(uint64_t key, TTData& data) const;
+        void store(uint64_t key, PackedMove move, int score, int depth, Bound bound);
+        void prefetch(uint64_t key) const;
+
+        //Permille of sampled entries written by the current search
+        int hashfull() const;
+        size_t getMegabytes() const;
+
+    private:
+        struct Entry {
+            std::atomic<uint64_t> keyXorData;
+            std::atomic<uint64_t> data;
+        };
+
+        static const int BUCKET_SIZE = 4;
+
+        struct alignas(64) Bucket {
+            Entry entries[BUCKET_SIZE];
+        };
+
+        //Entry ages wrap after this many searches
+        static const uint32_t AGE_MASK = (1u << 22) - 1;
+
+        std::unique_ptr<Bucket[]> buckets;
+        uint64_t bucketMask;
+        bool isolated;
+        //Low 22 bits are stored as the entry age. Atomic because the UCI thread clears while no search runs
+        std::atomic<uint32_t> generation;
+
+        uint32_t currentAge() const {
+            return generation.load(std::memory_order_relaxed) & AGE_MASK;
+        }
+
+        Bucket& bucketFor(uint64_t key) const {
+            return buckets[key & bucketMask];
+        }
+};
+
+extern TranspositionTable transpositionTable;
+
+#endif  // TT_H
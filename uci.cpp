@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "board.h"
+#include "nnue.h"
+#include "search.h"
+#include "trace.h"
+#include "tt.h"
+#include "uci.h"
+
+/**
+ * Everything the front-end keeps between commands: the current position with
+ * the keys of the game leading up to it, the options, and the running search.
+*/
+struct UciState {
+    Board board;
+    //Zobrist keys of the positions before the current one, oldest first
+    std::vector<uint64_t> gameKeys;
+    int threads = 1;
+
+    std::unique_ptr<Search> search;
+    std::thread searchThread;
+
+    //Guards holdBestMove. While set, the worker waits before printing bestmove
+    std::mutex mutex;
+    std::condition_variable released;
+    bool holdBestMove = false;
+    bool infinite = false;
+};
+
+/**
+ * Finds the legal move written in coordinate notation, e.g. e2e4 or e7e8q.
+ * Returns a null move if the text is malformed or the move is not legal.
+*/
+static PackedMove parseMove(Board& board, const std::string& text){
+    if(text.length() < 4 || text.length() > 5){
+        return PackedMove();
+    }
+    int source = board.algebraicToNumeric(text.substr(0, 2));
+    int target = board.algebraicToNumeric(text.substr(2, 2));
+    char promotion = text.length() == 5 ? text[4] : ' ';
+    if(source < 0 || target < 0){
+        return PackedMove();
+    }
+
+    MoveList moves;
+    board.generateLegalMoves(board.colorToMove(), moves);
+    for(PackedMove move : moves){
+        if(move.sourceSquare() != source || move.targetSquare() != target){
+            continue;
+        }
+        char movePromotion = move.flag() == PackedMove::PROMOTION_FLAG ? " pnbrqk"[move.promotedType()] : ' ';
+        if(movePromotion == promotion){
+            return move;
+        }
+    }
+    return PackedMove();
+}
+
+//Lets a waiting worker print its bestmove
+static void releaseBestMove(UciState& state){
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.holdBestMove = false;
+    }
+    state.released.notify_all();
+}
+
+//Stops the running search, if any, and waits for its bestmove to be printed
+static void finishSearch(UciState& state){
+    if(!state.searchThread.joinable()){
+        return;
+    }
+    state.search->stop();
+    releaseBestMove(state);
+    state.searchThread.join();
+    state.search.reset();
+}
+
+static void handlePosition(UciState& state, std::istringstream& command){
+    std::string token;
+    command >> token;
+
+    std::string fen;
+    if(token == "startpos"){
+        fen = START_FEN;
+        command >> token;
+    }
+    else if(token == "fen"){
+        while(command >> token && token != "moves"){
+            fen += (fen.empty() ? "" : " ") + token;
+        }
+    }
+    else{
+        return;
+    }
+
+    FenError error = state.board.parseFEN(fen);
+    if(error != FEN_OK){
+        printLine(std::string("info string invalid fen (") + fenErrorMessage(error) + ")");
+        return;
+    }
+    state.gameKeys.clear();
+
+    //token is "moves" here if any follow
+    while(command >> token){
+        PackedMove move = parseMove(state.board, token);
+        if(move.isNull()){
+            printLine("info string illegal move " + token);
+            break;
+        }
+        state.gameKeys.push_back(state.board.getZobristKey());
+        UndoInfo undo;
+        state.board.makeMove(move, undo);
+    }
+}
+
+static void handleGo(UciState& state, std::istringstream& command){
+    finishSearch(state);
+
+    SearchLimits limits;
+    bool infinite = false;
+    std::string token;
+    while(command >> token){
+        if(token == "infinite") infinite = true;
+        else if(token == "ponder") limits.ponder = true;
+        else{
+            long long value = 0;
+            command >> value;
+            if(token == "depth") limits.depth = std::max(1, std::min(int(value), MAX_PLY - 1));
+            else if(token == "nodes") limits.nodes = uint64_t(value);
+            else if(token == "movetime") limits.moveTime = value;
+            else if(token == "wtime") limits.time[WHITE] = value;
+            else if(token == "btime") limits.time[BLACK] = value;
+            else if(token == "winc") limits.increment[WHITE] = value;
+            else if(token == "binc") limits.increment[BLACK] = value;
+            else if(token == "movestogo") limits.movesToGo = int(value);
+        }
+    }
+
+    state.infinite = infinite;
+    state.holdBestMove = infinite || limits.ponder;
+    state.search.reset(new Search(state.board, limits, state.gameKeys, state.threads));
+
+    Search* search = state.search.get();
+    Board board = state.board;
+    UciState* shared = &state;
+    state.searchThread = std::thread([search, board, shared]() mutable {
+        PackedMove bestMove = search->think();
+        PackedMove ponderMove = search->getPonderMove();
+        {
+            std::unique_lock<std::mutex> lock(shared->mutex);
+            shared->released.wait(lock, [shared]{ return !shared->holdBestMove; });
+        }
+
+        if(bestMove.isNull()){
+            printLine("bestmove 0000");
+        }
+        else if(!ponderMove.isNull()){
+            printLine("bestmove " + board.moveToString(bestMove) + " ponder " + board.moveToString(ponderMove));
+        }
+        else{
+            printLine("bestmove " + board.moveToString(bestMove));
+        }
+    });
+}
+
+static void handleSetOption(UciState& state, std::istringstream& command){
+    //setoption name <name> [value <value>], where both may contain spaces
+    std::string token, name, value;
+    command >> token;
+    while(command >> token && token != "value"){
+        name += (name.empty() ? "" : " ") + token;
+    }
+    while(command >> token){
+        value += (value.empty() ? "" : " ") + token;
+    }
+
+    if(name == "Hash"){
+        transpositionTable.resize(size_t(std::max(1, std::atoi(value.c_str()))));
+    }
+    else if(name == "Threads"){
+        state.threads = std::max(1, std::atoi(value.c_str()));
+    }
+    else if(name == "EvalFile"){
+        if(value.empty() || value == "<empty>"){
+            return;
+        }
+        if(loadNetwork(value)){
+            printLine("info string loaded network " + value + " (" + nnueKernelName() + ")");
+        }
+        else{
+            printLine("info string could not load network " + value);
+        }
+    }
+    else{
+        printLine("info string unknown option " + name);
+    }
+}
+
+int runUci(std::istream& input){
+    UciState state;
+    state.board.setupPositionFromFEN(START_FEN);
+
+    std::string line;
+    while(std::getline(input, line)){
+        std::istringstream command(line);
+        std::string token;
+        command >> token;
+
+        if(token == "uci"){
+            printLine("id name AlphaOmega\n"
+                      "id author Brandon Jeremy\n"
+                      "option name Hash type spin default 16 min 1 max 65536\n"
+                      "option name Threads type spin default 1 min 1 max 256\n"
+                      "option name EvalFile type string default <empty>\n"
+                      "uciok");
+        }
+        else if(token == "isready"){
+            printLine("readyok");
+        }
+        else if(token == "ucinewgame"){
+            finishSearch(state);
+            transpositionTable.clear();
+        }
+        else if(token == "setoption"){
+            //Options change state the running search reads, so it must finish first
+            finishSearch(state);
+            handleSetOption(state, command);
+        }
+        else if(token == "position"){
+            finishSearch(state);
+            handlePosition(state, command);
+        }
+        else if(token == "go"){
+            handleGo(state, command);
+        }
+        else if(token == "stop"){
+            finishSearch(state);
+        }
+        else if(token == "ponderhit"){
+            if(state.search){
+                state.search->ponderhit();
+                if(!state.infinite){
+                    releaseBestMove(state);
+                }
+            }
+        }
+        else if(token == "trace"){
+            //Debugging aid outside the protocol: the retained trace lines go to stderr
+            if(!traceDump(std::cerr)){
+                printLine("info string no trace ring, build with -DALPHAOMEGA_TRACE_RING=1");
+            }
+        }
+        else if(token == "quit"){
+            break;
+        }
+    }
+
+    finishSearch(state);
+    return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef UCI_H
+#define UCI_H
+
+#include <iostream>
+
+/**
+ * Universal Chess Interface front-end. Reads commands from input until
+ * "quit" or end of input and answers on std::cout.
+ *
+ * Supported: uci, isready, ucinewgame, setoption (Hash, Threads, EvalFile),
+ * position startpos|fen ... [moves ...], go (depth, nodes, movetime, wtime,
+ * btime, winc, binc, movestogo, infinite, ponder), stop, ponderhit and quit.
+ * The extra command trace prints the trace ring to std::cerr (see trace.h).
+ *
+ * go starts the search on a worker thread and returns at once, so stop,
+ * ponderhit and isready are answered while it runs. After go infinite or go
+ * ponder the bestmove line is held back until stop or ponderhit, as the
+ * protocol requires, even if the search finishes first.
+*/
+int runUci(std::istream& input);
+
+#endif  // UCI_H
@@ -0,0 +1,34 @@
+#include "zobrist.h"
+
+//splitmix64, fixed seed so keys (and anything stored by key) are the same every run
+static constexpr uint64_t nextKey(uint64_t& state){
+    state += 0x9E3779B97F4A7C15ULL;
+    uint64_t key = state;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+}
+
+static constexpr ZobristKeys generateKeys(){
+    ZobristKeys keys{};
+    uint64_t state = 0x416C7068614F6D65ULL;
+
+    for(int color = 0; color < 2; color++){
+        for(int pieceType = 1; pieceType < 7; pieceType++){
+            for(int squareIndex = 0; squareIndex < 64; squareIndex++){
+                keys.pieces[color][pieceType][squareIndex] = nextKey(state);
+            }
+        }
+    }
+    //No rights is the common endgame case, leave it as 0
+    for(int rights = 1; rights < 16; rights++){
+        keys.castling[rights] = nextKey(state);
+    }
+    for(int file = 0; file < 8; file++){
+        keys.enPassantFile[file] = nextKey(state);
+    }
+    keys.blackToMove = nextKey(state);
+    return keys;
+}
+
+constexpr ZobristKeys zobristKeys = generateKeys();
@@ -0,0 +1,22 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+
+/**
+ * Random keys for Zobrist hashing. A position's key is the XOR of the key for
+ * every piece on its square, the castling rights mask, the en passant file
+ * (when there is a target square) and the side key when black is to move.
+ * Any change to the position is applied by XORing the affected keys in or out.
+*/
+struct ZobristKeys {
+    uint64_t pieces[2][7][64];  //[color][piece type][square]
+    uint64_t castling[16];      //Indexed by the CastlingRight mask
+    uint64_t enPassantFile[8];
+    uint64_t blackToMove;
+};
+
+//Generated at compile time, so usable before main() runs
+extern const ZobristKeys zobristKeys;
+
+#endif  // ZOBRIST_H